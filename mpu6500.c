@@ -10,6 +10,13 @@
  */
 
 #include "mpu6500.h"
+#include <string.h>
+#include <math.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /* MPU6500 Register Addresses */
 #define SELF_TEST_X_GYRO	0x00
@@ -113,349 +120,2514 @@
 #define ZA_OFFSET_H			0x7D
 #define ZA_OFFSET_L			0x7E
 
-int16_t accel_offset[3];
-int16_t gyro_offset[3];
+/* Non-blocking transfer steps, indexed by MPU6500_READ_xxx bit position */
+static const struct {
+    uint8_t reg;        // First register of the step
+    uint8_t len;        // Number of bytes
+    uint8_t offset;     // Position inside the 14-byte frame
+} mpu6500_async_steps[] = {
+    { ACCEL_XOUT_H, 6, 0 },                     // MPU6500_READ_ACCEL
+    { TEMP_OUT_H, 2, 6 },                       // MPU6500_READ_TEMP
+    { GYRO_XOUT_H, 6, 8 },                      // MPU6500_READ_GYRO
+    { ACCEL_XOUT_H, MPU6500_SAMPLE_SIZE, 0 },   // MPU6500_READ_BURST
+};
+
+/* Gyro DLPF_CFG characteristics (FCHOICE_B = 00) */
+static const MPU6500_FilterInfo mpu6500_gyro_filters[8] = {
+    { 250.0f, 970, 8000 }, { 184.0f, 2900, 1000 }, { 92.0f, 3900, 1000 }, { 41.0f, 5900, 1000 },
+    { 20.0f, 9900, 1000 }, { 10.0f, 17850, 1000 }, { 5.0f, 33480, 1000 }, { 3600.0f, 170, 8000 },
+};
+
+/* Accel A_DLPF_CFG characteristics (ACCEL_FCHOICE_B = 0), register map rev 2.1 register 29 */
+static const MPU6500_FilterInfo mpu6500_accel_filters[8] = {
+    { 460.0f, 1940, 1000 }, { 184.0f, 5800, 1000 }, { 92.0f, 7800, 1000 }, { 41.0f, 11800, 1000 },
+    { 20.0f, 19800, 1000 }, { 10.0f, 35700, 1000 }, { 5.0f, 66960, 1000 }, { 460.0f, 1940, 1000 },
+};
+
+/* Accel DLPF bypass (ACCEL_FCHOICE_B = 1) */
+static const MPU6500_FilterInfo mpu6500_accel_bypass = { 1130.0f, 750, 4000 };
+
+/* Sensitivity per FS_SEL[4:3] value */
+static const float mpu6500_accel_sens[4] = {
+    MPU6500_ACCEL_SENS_2G, MPU6500_ACCEL_SENS_4G, MPU6500_ACCEL_SENS_8G, MPU6500_ACCEL_SENS_16G
+};
+static const float mpu6500_gyro_sens[4] = {
+    MPU6500_GYRO_SENS_250DPS, MPU6500_GYRO_SENS_500DPS, MPU6500_GYRO_SENS_1000DPS, MPU6500_GYRO_SENS_2000DPS
+};
+
+/* Reciprocal sensitivities, so conversions multiply instead of divide */
+static const float mpu6500_accel_scale[4] = {
+    1.0f / MPU6500_ACCEL_SENS_2G, 1.0f / MPU6500_ACCEL_SENS_4G, 1.0f / MPU6500_ACCEL_SENS_8G, 1.0f / MPU6500_ACCEL_SENS_16G
+};
+static const float mpu6500_gyro_scale[4] = {
+    1.0f / MPU6500_GYRO_SENS_250DPS, 1.0f / MPU6500_GYRO_SENS_500DPS, 1.0f / MPU6500_GYRO_SENS_1000DPS, 1.0f / MPU6500_GYRO_SENS_2000DPS
+};
+
+/* Fixed-point coefficient: output units per raw LSB, Q16 (unit is 65536 for Q16.16, 1000 for milli).
+ * Sensitivities are given as double literals, the float MPU6500_xxx_SENS macros
+ * would put up to 3 LSB of error into Q16.16 gyro output. */
+#define MPU6500_FIXED_COEF(unit, sens)  ((uint32_t)((unit) * 65536.0 / (sens) + 0.5))
+#define MPU6500_FIXED_ROW(unit, s0, s1, s2, s3) \
+    { MPU6500_FIXED_COEF(unit, s0), MPU6500_FIXED_COEF(unit, s1), MPU6500_FIXED_COEF(unit, s2), MPU6500_FIXED_COEF(unit, s3) }
+
+/* Fixed-point coefficients per MPU6500_FIXED_xxx format and full scale range */
+static const uint32_t mpu6500_accel_fixed[2][4] = {
+    MPU6500_FIXED_ROW(65536.0, 16384.0, 8192.0, 4096.0, 2048.0),
+    MPU6500_FIXED_ROW(1000.0, 16384.0, 8192.0, 4096.0, 2048.0)
+};
+static const uint32_t mpu6500_gyro_fixed[2][4] = {
+    MPU6500_FIXED_ROW(65536.0, 131.0, 65.5, 32.8, 16.4),
+    MPU6500_FIXED_ROW(1000.0, 131.0, 65.5, 32.8, 16.4)
+};
+static const uint32_t mpu6500_temp_fixed[2] = {
+    MPU6500_FIXED_COEF(65536.0, 333.87), MPU6500_FIXED_COEF(1000.0, 333.87)
+};
+static const int32_t mpu6500_temp_fixed_offset[2] = {
+    (int32_t)(MPU6500_TEMP_OFFSET * 65536.0), (int32_t)(MPU6500_TEMP_OFFSET * 1000.0)
+};
+
+/* Register address of each MPU6500_SHADOW_xxx slot */
+static const uint8_t mpu6500_shadow_regs[MPU6500_SHADOW_COUNT] = {
+    SMPLRT_DIV, CONFIG, GYRO_CONFIG, ACCEL_CONFIG, ACCEL_CONFIG_2, FIFO_EN,
+    INT_PIN_CFG, INT_ENABLE, USER_CTRL, PWR_MGMT_1, PWR_MGMT_2
+};
+
+/* Contiguous shadowed blocks, each read or written with one transfer */
+static const struct {
+    uint8_t reg;        // First register of the block
+    uint8_t len;        // Number of registers
+    uint8_t slot;       // Shadow slot of the first register
+} mpu6500_shadow_blocks[] = {
+    { SMPLRT_DIV, 5, MPU6500_SHADOW_SMPLRT_DIV },   // SMPLRT_DIV..ACCEL_CONFIG_2
+    { FIFO_EN, 1, MPU6500_SHADOW_FIFO_EN },
+    { INT_PIN_CFG, 2, MPU6500_SHADOW_INT_PIN_CFG },  // INT_PIN_CFG, INT_ENABLE
+    { USER_CTRL, 3, MPU6500_SHADOW_USER_CTRL },      // USER_CTRL..PWR_MGMT_2
+};
+
+#ifdef HAL_I2C_MODULE_ENABLED
+/**
+ * @brief I2C transport: blocking burst read
+ */
+static HAL_StatusTypeDef MPU6500_I2C_Read(void *ctx, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t len, uint32_t timeout){
+    return HAL_I2C_Mem_Read((I2C_HandleTypeDef *)ctx, (uint16_t)(addr << 1), reg, I2C_MEMADD_SIZE_8BIT, data, len, timeout);
+}
+
+/**
+ * @brief I2C transport: blocking burst write
+ */
+static HAL_StatusTypeDef MPU6500_I2C_Write(void *ctx, uint8_t addr, uint8_t reg, const uint8_t *data, uint16_t len, uint32_t timeout){
+    return HAL_I2C_Mem_Write((I2C_HandleTypeDef *)ctx, (uint16_t)(addr << 1), reg, I2C_MEMADD_SIZE_8BIT, (uint8_t *)data, len, timeout);
+}
+
+/**
+ * @brief I2C transport: non-blocking burst read
+ */
+static HAL_StatusTypeDef MPU6500_I2C_ReadAsync(void *ctx, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t len, uint8_t mode){
+    if(mode == MPU6500_ASYNC_DMA){
+        return HAL_I2C_Mem_Read_DMA((I2C_HandleTypeDef *)ctx, (uint16_t)(addr << 1), reg, I2C_MEMADD_SIZE_8BIT, data, len);
+    }
+    return HAL_I2C_Mem_Read_IT((I2C_HandleTypeDef *)ctx, (uint16_t)(addr << 1), reg, I2C_MEMADD_SIZE_8BIT, data, len);
+}
+
+/**
+ * @brief I2C transport: classify the last error
+ */
+static MPU6500_BusError MPU6500_I2C_Error(void *ctx){
+    uint32_t error;
+
+    // Not ready: a non-blocking transfer (maybe of another sensor) owns the peripheral
+    if(HAL_I2C_GetState((I2C_HandleTypeDef *)ctx) != HAL_I2C_STATE_READY) return MPU6500_BUS_ERR_BUSY;
+    error = HAL_I2C_GetError((I2C_HandleTypeDef *)ctx);
+    if(error == HAL_I2C_ERROR_NONE) return MPU6500_BUS_ERR_NONE;
+    if(error & HAL_I2C_ERROR_AF) return MPU6500_BUS_ERR_NACK;
+    if(error & (HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO)) return MPU6500_BUS_ERR_BUS;
+    if(error & HAL_I2C_ERROR_TIMEOUT) return MPU6500_BUS_ERR_TIMEOUT;
+    return MPU6500_BUS_ERR_OTHER;
+}
+
+/**
+ * @brief I2C transport: re-initialize the peripheral
+ */
+static HAL_StatusTypeDef MPU6500_I2C_Reinit(void *recover_ctx){
+    I2C_HandleTypeDef *hi2c = (I2C_HandleTypeDef *)recover_ctx;
+
+    HAL_I2C_DeInit(hi2c);
+    return HAL_I2C_Init(hi2c);
+}
+
+/**
+ * @brief I2C transport: stop a non-blocking read
+ * @note HAL versions that cannot abort memory transfers refuse the request;
+ *       re-initializing the peripheral stops it as well.
+ */
+static void MPU6500_I2C_Abort(void *ctx, uint8_t addr){
+    I2C_HandleTypeDef *hi2c = (I2C_HandleTypeDef *)ctx;
+
+    if(HAL_I2C_Master_Abort_IT(hi2c, (uint16_t)(addr << 1)) != HAL_OK){
+        MPU6500_I2C_Reinit(hi2c);
+    }
+}
+
+/**
+ * @brief Busy-wait half an SCL period of the bus clear
+ */
+static void MPU6500_I2C_HalfBit(void){
+    for(volatile uint32_t i = 0; i < MPU6500_UNSTICK_DELAY; i++);
+}
+
+/**
+ * @brief I2C transport: clock a stuck bus free, then re-initialize the peripheral
+ * @note A sensor interrupted mid-byte (e.g. by a reset of the MCU or a glitch)
+ *       keeps SDA low until it has clocked out the rest of its byte.
+ */
+static HAL_StatusTypeDef MPU6500_I2C_Unstick(void *recover_ctx){
+    MPU6500_I2C_Recovery *rec = (MPU6500_I2C_Recovery *)recover_ctx;
+    GPIO_InitTypeDef gpio = {0};
+    HAL_StatusTypeDef status;
+    uint8_t released;
+
+    // Take the pins away from the peripheral (HAL_I2C_MspDeInit)
+    HAL_I2C_DeInit(rec->hi2c);
+    gpio.Mode = GPIO_MODE_OUTPUT_OD;
+    gpio.Pull = GPIO_NOPULL;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_WritePin(rec->scl_port, rec->scl_pin, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(rec->sda_port, rec->sda_pin, GPIO_PIN_SET);
+    gpio.Pin = rec->scl_pin;
+    HAL_GPIO_Init(rec->scl_port, &gpio);
+    gpio.Pin = rec->sda_pin;
+    HAL_GPIO_Init(rec->sda_port, &gpio);
+    MPU6500_I2C_HalfBit();
+
+    // Up to 9 clocks: the rest of the byte plus its ACK bit
+    for(uint8_t i = 0; i < 9 && HAL_GPIO_ReadPin(rec->sda_port, rec->sda_pin) == GPIO_PIN_RESET; i++){
+        HAL_GPIO_WritePin(rec->scl_port, rec->scl_pin, GPIO_PIN_RESET);
+        MPU6500_I2C_HalfBit();
+        HAL_GPIO_WritePin(rec->scl_port, rec->scl_pin, GPIO_PIN_SET);
+        MPU6500_I2C_HalfBit();
+    }
+
+    // STOP condition: SDA rises while SCL is high
+    HAL_GPIO_WritePin(rec->scl_port, rec->scl_pin, GPIO_PIN_RESET);
+    MPU6500_I2C_HalfBit();
+    HAL_GPIO_WritePin(rec->sda_port, rec->sda_pin, GPIO_PIN_RESET);
+    MPU6500_I2C_HalfBit();
+    HAL_GPIO_WritePin(rec->scl_port, rec->scl_pin, GPIO_PIN_SET);
+    MPU6500_I2C_HalfBit();
+    HAL_GPIO_WritePin(rec->sda_port, rec->sda_pin, GPIO_PIN_SET);
+    MPU6500_I2C_HalfBit();
+    released = (HAL_GPIO_ReadPin(rec->sda_port, rec->sda_pin) == GPIO_PIN_SET);
+
+    // Hand the pins back to the peripheral (HAL_I2C_MspInit)
+    status = HAL_I2C_Init(rec->hi2c);
+    if(status != HAL_OK) return status;
+    return released ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief Set up a transport for the STM32 HAL I2C driver
+ * @param bus Transport to initialize
+ * @param hi2c I2C handle the sensor is connected to
+ */
+void MPU6500_Transport_InitI2C(MPU6500_Transport *bus, I2C_HandleTypeDef *hi2c){
+    bus->type = MPU6500_BUS_I2C;
+    bus->read = MPU6500_I2C_Read;
+    bus->write = MPU6500_I2C_Write;
+    bus->read_async = MPU6500_I2C_ReadAsync;
+    bus->read_async_end = NULL;
+    bus->abort = MPU6500_I2C_Abort;
+    bus->error = MPU6500_I2C_Error;
+    bus->recover = MPU6500_I2C_Reinit;
+    bus->delay = HAL_Delay;
+    bus->ctx = hi2c;
+    bus->recover_ctx = hi2c;
+    bus->clock_hz = 400000;     // Fast mode, adjust if the bus runs slower
+}
+
+/**
+ * @brief Let the I2C transport clock a stuck bus free during recovery
+ * @param bus Transport set up by MPU6500_Transport_InitI2C
+ * @param recovery I2C handle and SCL/SDA pins, must outlive the transport
+ */
+void MPU6500_Transport_SetI2CRecovery(MPU6500_Transport *bus, MPU6500_I2C_Recovery *recovery){
+    bus->recover = MPU6500_I2C_Unstick;
+    bus->recover_ctx = recovery;
+}
+#endif
+
+#ifdef HAL_SPI_MODULE_ENABLED
+/* SPI register address byte: bit 7 selects read (1) or write (0) */
+#define MPU6500_SPI_READ    0x80
+
+/* Longest burst written in one SPI transaction */
+#define MPU6500_SPI_MAX_WRITE   16
+
+/**
+ * @brief SPI transport: select the clock allowed for an access
+ * @param spi SPI transport context
+ * @param reg Register accessed
+ * @param read 1 for a read, 0 for a write
+ * @note Sensor data, interrupt status and FIFO reads run at up to 20 MHz,
+ *       every other access at up to 1 MHz. Must be called with CS high.
+ */
+static void MPU6500_SPI_SelectSpeed(MPU6500_SPI_Bus *spi, uint8_t reg, uint8_t read){
+#if defined(SPI_CR1_BR)
+    uint32_t prescaler = spi->slow_prescaler;
+
+    if(!spi->dual_speed) return;
+    if(read && ((reg >= INT_STATUS && reg <= EXT_SENS_DATA_23) || (reg >= FIFO_COUNT_H && reg <= FIFO_R_W))){
+        prescaler = spi->fast_prescaler;
+    }
+    if((spi->hspi->Instance->CR1 & SPI_CR1_BR) == prescaler) return;
+    // BR may only change while the peripheral is idle, the HAL re-enables it
+    __HAL_SPI_DISABLE(spi->hspi);
+    MODIFY_REG(spi->hspi->Instance->CR1, SPI_CR1_BR, prescaler);
+    spi->hspi->Init.BaudRatePrescaler = prescaler;
+#else
+    (void)spi;
+    (void)reg;
+    (void)read;
+#endif
+}
+
+/**
+ * @brief SPI transport: blocking burst read
+ */
+static HAL_StatusTypeDef MPU6500_SPI_Read(void *ctx, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t len, uint32_t timeout){
+    MPU6500_SPI_Bus *spi = (MPU6500_SPI_Bus *)ctx;
+    HAL_StatusTypeDef status;
+    uint8_t tx = reg | MPU6500_SPI_READ;
+    (void)addr;
+    MPU6500_SPI_SelectSpeed(spi, reg, 1);
+    HAL_GPIO_WritePin(spi->cs_port, spi->cs_pin, GPIO_PIN_RESET);
+    status = HAL_SPI_Transmit(spi->hspi, &tx, 1, timeout);
+    if(status == HAL_OK) status = HAL_SPI_Receive(spi->hspi, data, len, timeout);
+    HAL_GPIO_WritePin(spi->cs_port, spi->cs_pin, GPIO_PIN_SET);
+    return status;
+}
+
+/**
+ * @brief SPI transport: blocking burst write
+ */
+static HAL_StatusTypeDef MPU6500_SPI_Write(void *ctx, uint8_t addr, uint8_t reg, const uint8_t *data, uint16_t len, uint32_t timeout){
+    MPU6500_SPI_Bus *spi = (MPU6500_SPI_Bus *)ctx;
+    HAL_StatusTypeDef status;
+    uint8_t frame[1 + MPU6500_SPI_MAX_WRITE];
+    (void)addr;
+    if(len > MPU6500_SPI_MAX_WRITE) return HAL_ERROR;
+    frame[0] = reg & (uint8_t)~MPU6500_SPI_READ;
+    memcpy(&frame[1], data, len);
+    MPU6500_SPI_SelectSpeed(spi, reg, 0);
+    HAL_GPIO_WritePin(spi->cs_port, spi->cs_pin, GPIO_PIN_RESET);
+    status = HAL_SPI_Transmit(spi->hspi, frame, (uint16_t)(len + 1), timeout);
+    HAL_GPIO_WritePin(spi->cs_port, spi->cs_pin, GPIO_PIN_SET);
+    return status;
+}
+
+/**
+ * @brief SPI transport: non-blocking burst read
+ * @note The address byte is sent blocking (< 1 µs), only the data phase is
+ *       deferred. Chip select is released by MPU6500_SPI_ReadAsyncEnd.
+ */
+static HAL_StatusTypeDef MPU6500_SPI_ReadAsync(void *ctx, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t len, uint8_t mode){
+    MPU6500_SPI_Bus *spi = (MPU6500_SPI_Bus *)ctx;
+    HAL_StatusTypeDef status;
+    uint8_t tx = reg | MPU6500_SPI_READ;
+    (void)addr;
+    MPU6500_SPI_SelectSpeed(spi, reg, 1);
+    HAL_GPIO_WritePin(spi->cs_port, spi->cs_pin, GPIO_PIN_RESET);
+    status = HAL_SPI_Transmit(spi->hspi, &tx, 1, 1);
+    if(status == HAL_OK){
+        if(mode == MPU6500_ASYNC_DMA){
+            status = HAL_SPI_Receive_DMA(spi->hspi, data, len);
+        } else {
+            status = HAL_SPI_Receive_IT(spi->hspi, data, len);
+        }
+    }
+    if(status != HAL_OK) HAL_GPIO_WritePin(spi->cs_port, spi->cs_pin, GPIO_PIN_SET);
+    return status;
+}
+
+/**
+ * @brief SPI transport: release chip select after a non-blocking read
+ */
+static void MPU6500_SPI_ReadAsyncEnd(void *ctx){
+    MPU6500_SPI_Bus *spi = (MPU6500_SPI_Bus *)ctx;
+    HAL_GPIO_WritePin(spi->cs_port, spi->cs_pin, GPIO_PIN_SET);
+}
+
+/**
+ * @brief SPI transport: stop a non-blocking read
+ */
+static void MPU6500_SPI_Abort(void *ctx, uint8_t addr){
+    MPU6500_SPI_Bus *spi = (MPU6500_SPI_Bus *)ctx;
+    (void)addr;
+    HAL_SPI_Abort(spi->hspi);
+    HAL_GPIO_WritePin(spi->cs_port, spi->cs_pin, GPIO_PIN_SET);
+}
+
+/**
+ * @brief SPI transport: classify the last error
+ */
+static MPU6500_BusError MPU6500_SPI_Error(void *ctx){
+    MPU6500_SPI_Bus *spi = (MPU6500_SPI_Bus *)ctx;
+    if(HAL_SPI_GetState(spi->hspi) != HAL_SPI_STATE_READY) return MPU6500_BUS_ERR_BUSY;
+    return (HAL_SPI_GetError(spi->hspi) == HAL_SPI_ERROR_NONE) ? MPU6500_BUS_ERR_NONE : MPU6500_BUS_ERR_OTHER;
+}
+
+/**
+ * @brief Set up a transport for the STM32 HAL SPI driver
+ * @param bus Transport to initialize
+ * @param spi SPI handle and chip select pin, must outlive the transport
+ */
+void MPU6500_Transport_InitSPI(MPU6500_Transport *bus, MPU6500_SPI_Bus *spi){
+    bus->type = MPU6500_BUS_SPI;
+    bus->read = MPU6500_SPI_Read;
+    bus->write = MPU6500_SPI_Write;
+    bus->read_async = MPU6500_SPI_ReadAsync;
+    bus->read_async_end = MPU6500_SPI_ReadAsyncEnd;
+    bus->abort = MPU6500_SPI_Abort;
+    bus->error = MPU6500_SPI_Error;
+    bus->recover = NULL;        // SPI has no bus state to recover
+    bus->delay = HAL_Delay;
+    bus->ctx = spi;
+    bus->recover_ctx = NULL;
+    bus->clock_hz = 1000000;    // Register write limit, raise with the SPI prescaler
+}
+#endif
+
+/**
+ * @brief Classify a failed transfer and count it
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param status Status returned by the transport
+ * @return MPU6500_BusError Error class
+ */
+static MPU6500_BusError MPU6500_CountError(MPU6500_Handle *hmpu, HAL_StatusTypeDef status){
+    MPU6500_BusError error = MPU6500_BUS_ERR_OTHER;
+
+    if(status == HAL_TIMEOUT){
+        error = MPU6500_BUS_ERR_TIMEOUT;
+    } else if(status == HAL_BUSY){
+        // Either another transfer holds the peripheral (on a shared bus, maybe
+        // another sensor's DMA) or the peripheral saw SDA/SCL held low
+        error = MPU6500_BUS_ERR_BUS;
+        if(hmpu->bus->error != NULL && hmpu->bus->error(hmpu->bus->ctx) == MPU6500_BUS_ERR_BUSY) error = MPU6500_BUS_ERR_BUSY;
+    } else if(hmpu->bus->error != NULL){
+        error = hmpu->bus->error(hmpu->bus->ctx);
+    }
+
+    switch(error){
+    case MPU6500_BUS_ERR_NACK:
+        hmpu->stats.nacks++;
+        break;
+    case MPU6500_BUS_ERR_BUS:
+        hmpu->stats.bus_errors++;
+        break;
+    case MPU6500_BUS_ERR_TIMEOUT:
+        hmpu->stats.timeouts++;
+        break;
+    case MPU6500_BUS_ERR_BUSY:
+        hmpu->stats.busy++;
+        break;
+    default:
+        hmpu->stats.other_errors++;
+        break;
+    }
+    return error;
+}
+
+/**
+ * @brief Delay before a retry
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param attempt Number of retries already made
+ * @return uint32_t Backoff in ms
+ */
+static uint32_t MPU6500_Backoff(MPU6500_Handle *hmpu, uint8_t attempt){
+    // 16-bit base shifted by at most 31 fits 64 bits, max_retries may be up to 255
+    uint64_t backoff = (uint64_t)hmpu->retry.backoff_ms << ((attempt > 31) ? 31 : attempt);
+
+    return (backoff > hmpu->retry.backoff_max_ms) ? hmpu->retry.backoff_max_ms : (uint32_t)backoff;
+}
+
+/**
+ * @brief Decide whether a failed transfer is retried, recovering the bus if needed
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param status Status returned by the transport
+ * @param attempt Number of retries already made
+ * @param slack_us Time available for the backoff (µs), UINT32_MAX if unbounded
+ * @return uint8_t 1 to retry the transfer, 0 to give up
+ */
+static uint8_t MPU6500_BusRetry(MPU6500_Handle *hmpu, HAL_StatusTypeDef status, uint8_t attempt, uint32_t slack_us){
+    MPU6500_BusError error = MPU6500_CountError(hmpu, status);
+    uint32_t backoff = MPU6500_Backoff(hmpu, attempt);
+
+    // Anything but a NACK may leave the bus or the peripheral stuck. Recover
+    // after the last attempt too, so the next transfer finds a usable bus.
+    // Never pull the peripheral away from a running non-blocking transfer,
+    // ours or that of another sensor sharing the bus.
+    if(error != MPU6500_BUS_ERR_NACK && error != MPU6500_BUS_ERR_BUSY && hmpu->bus->recover != NULL &&
+       hmpu->async.state != MPU6500_ASYNC_BUSY){
+        hmpu->stats.recoveries++;
+        hmpu->bus->recover(hmpu->bus->recover_ctx);
+    }
+    if(attempt >= hmpu->retry.max_retries || (uint64_t)backoff * 1000U > slack_us){
+        hmpu->stats.failures++;
+        return 0;
+    }
+
+    if(backoff != 0) hmpu->bus->delay(backoff);
+    hmpu->stats.retries++;
+    return 1;
+}
+
+/**
+ * @brief Update the time left to a read with a deadline
+ * @param budget_us Budget of the whole read (µs)
+ * @param start Tick at the start of the read
+ * @param left Time left before the last step (µs)
+ * @param used Time the last step took at least (µs)
+ * @return uint32_t Time left (µs), the lower of the estimate and the tick count
+ */
+static uint32_t MPU6500_TimeLeft(uint32_t budget_us, uint32_t start, uint32_t left, uint32_t used){
+    uint32_t ticks = HAL_GetTick() - start;
+    uint64_t elapsed;
+
+    left = (left > used) ? left - used : 0;
+    // The first tick may have ended right after start, only ticks - 1 ms surely passed
+    if(ticks > 1){
+        elapsed = (uint64_t)(ticks - 1) * 1000U;
+        if(elapsed >= budget_us) return 0;
+        if(budget_us - elapsed < left) left = budget_us - (uint32_t)elapsed;
+    }
+    return left;
+}
+
+/**
+ * @brief Read from the sensor through the transport, applying the retry policy
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param reg First register address to read from
+ * @param data Pointer to store read data
+ * @param len Number of bytes to read
+ * @param budget_us NULL to use the read timeout, else time the read may take
+ *        in µs, retries included; updated to the time left
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static HAL_StatusTypeDef MPU6500_BusRead(MPU6500_Handle *hmpu, uint8_t reg, uint8_t *data, uint16_t len, uint32_t *budget_us){
+    HAL_StatusTypeDef status;
+    uint32_t timeout = hmpu->read_timeout, slack = UINT32_MAX;
+    uint32_t cost = 0, left = 0, start = 0;
+    uint8_t attempt = 0;
+
+    if(budget_us != NULL){
+        cost = MPU6500_EstimateReadTime(hmpu, len);
+        left = *budget_us;
+        start = HAL_GetTick();
+    }
+    for(;;){
+        // HAL timeouts have tick (1 ms) resolution
+        if(budget_us != NULL) timeout = (left + 999U) / 1000U;
+        status = hmpu->bus->read(hmpu->bus->ctx, hmpu->address, reg, data, len, timeout);
+        if(budget_us != NULL){
+            left = MPU6500_TimeLeft(*budget_us, start, left, cost);
+            slack = (left > cost) ? left - cost : 0;     // Room for a backoff before one more transfer
+        }
+        if(status == HAL_OK || !MPU6500_BusRetry(hmpu, status, attempt, slack)) break;
+        if(budget_us != NULL) left = MPU6500_TimeLeft(*budget_us, start, left, MPU6500_Backoff(hmpu, attempt) * 1000U);
+        attempt++;
+    }
+    if(budget_us != NULL) *budget_us = left;
+    return status;
+}
+
+/**
+ * @brief Write to the sensor through the transport, applying the retry policy
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param reg First register address to write to
+ * @param data Data to write
+ * @param len Number of bytes to write
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static HAL_StatusTypeDef MPU6500_BusWrite(MPU6500_Handle *hmpu, uint8_t reg, const uint8_t *data, uint16_t len){
+    HAL_StatusTypeDef status;
+    uint8_t attempt = 0;
+
+    do {
+        status = hmpu->bus->write(hmpu->bus->ctx, hmpu->address, reg, data, len, hmpu->write_timeout);
+    } while(status != HAL_OK && MPU6500_BusRetry(hmpu, status, attempt++, UINT32_MAX));
+    return status;
+}
+
+/**
+ * @brief Read consecutive MPU6500 registers in a single transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param reg First register address to read from
+ * @param data Pointer to store read data
+ * @param len Number of bytes to read
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static inline HAL_StatusTypeDef MPU6500_ReadRegisters(MPU6500_Handle *hmpu, uint8_t reg, uint8_t *data, uint16_t len){
+    return MPU6500_BusRead(hmpu, reg, data, len, NULL);
+}
+
+/**
+ * @brief Read a single byte from an MPU6500 register
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param reg Register address to read from
+ * @param data Pointer to store read data
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static inline HAL_StatusTypeDef MPU6500_ReadRegister(MPU6500_Handle *hmpu, uint8_t reg, uint8_t *data){
+    return MPU6500_ReadRegisters(hmpu, reg, data, 1);
+}
+
+/**
+ * @brief Get the shadow slot of a register
+ * @param reg Register address
+ * @return int8_t MPU6500_SHADOW_xxx slot, or -1 if the register is not shadowed
+ */
+static int8_t MPU6500_ShadowSlot(uint8_t reg){
+    int8_t slot;
+    for(slot = 0; slot < MPU6500_SHADOW_COUNT; slot++){
+        if(mpu6500_shadow_regs[slot] == reg) return slot;
+    }
+    return -1;
+}
+
+/**
+ * @brief Write a single byte to an MPU6500 register
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param reg Register address to write to
+ * @param data Data byte to write
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Keeps the register shadow up to date. With MPU6500_SHADOW_CHECK
+ *       defined, shadowed registers are read back and compared.
+ */
+static HAL_StatusTypeDef MPU6500_WriteRegister(MPU6500_Handle *hmpu, uint8_t reg, uint8_t data){
+    HAL_StatusTypeDef status;
+    int8_t slot = MPU6500_ShadowSlot(reg);
+
+    status = MPU6500_BusWrite(hmpu, reg, &data, 1);
+    if(status != HAL_OK || slot < 0) return status;
+    hmpu->shadow[slot] = data;
+    hmpu->shadow_dirty &= (uint16_t)~(1U << slot);
+#ifdef MPU6500_SHADOW_CHECK
+    {
+        uint8_t readback;
+        status = MPU6500_ReadRegister(hmpu, reg, &readback);
+        if(status != HAL_OK) return status;
+        // DEVICE_RESET self-clears, it is not a configuration bit
+        if(reg == PWR_MGMT_1) readback |= (data & 0x80);
+        if(readback != data) return HAL_ERROR;
+    }
+#endif
+    return HAL_OK;
+}
+
+/**
+ * @brief Modify bits of a shadowed register without reading it first
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param slot MPU6500_SHADOW_xxx slot of the register
+ * @param clear Bits to clear
+ * @param set Bits to set
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static inline HAL_StatusTypeDef MPU6500_UpdateRegister(MPU6500_Handle *hmpu, uint8_t slot, uint8_t clear, uint8_t set){
+    uint8_t value = (uint8_t)((hmpu->shadow[slot] & ~clear) | set);
+    return MPU6500_WriteRegister(hmpu, mpu6500_shadow_regs[slot], value);
+}
+
+/**
+ * @brief Modify bits of a shadowed register, deferring the write
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param slot MPU6500_SHADOW_xxx slot of the register
+ * @param clear Bits to clear
+ * @param set Bits to set
+ * @note The change reaches the sensor with the next MPU6500_CommitConfig.
+ */
+static inline void MPU6500_StageRegister(MPU6500_Handle *hmpu, uint8_t slot, uint8_t clear, uint8_t set){
+    uint8_t value = (uint8_t)((hmpu->shadow[slot] & ~clear) | set);
+    if(value == hmpu->shadow[slot]) return;
+    hmpu->shadow[slot] = value;
+    hmpu->shadow_dirty |= (uint16_t)(1U << slot);
+}
+
+/**
+ * @brief Write all staged configuration changes to the sensor
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note One burst write per contiguous block that holds dirty registers,
+ *       spanning from its first to its last dirty register.
+ */
+HAL_StatusTypeDef MPU6500_CommitConfig(MPU6500_Handle *hmpu){
+    HAL_StatusTypeDef status;
+    uint8_t i, first, last;
+
+    for(i = 0; i < sizeof(mpu6500_shadow_blocks) / sizeof(mpu6500_shadow_blocks[0]); i++){
+        first = mpu6500_shadow_blocks[i].slot;
+        last = (uint8_t)(first + mpu6500_shadow_blocks[i].len - 1);
+        while(first <= last && !(hmpu->shadow_dirty & (1U << first))) first++;
+        while(last > first && !(hmpu->shadow_dirty & (1U << last))) last--;
+        if(first > last) continue;
+
+        status = MPU6500_BusWrite(hmpu, mpu6500_shadow_regs[first], &hmpu->shadow[first], (uint16_t)(last - first + 1));
+        if(status != HAL_OK) return status;
+        hmpu->shadow_dirty &= (uint16_t)~(((1U << (last - first + 1)) - 1) << first);
+#ifdef MPU6500_SHADOW_CHECK
+        {
+            uint8_t readback[MPU6500_SHADOW_COUNT];
+            status = MPU6500_ReadRegisters(hmpu, mpu6500_shadow_regs[first], readback, (uint16_t)(last - first + 1));
+            if(status != HAL_OK) return status;
+            if(first <= MPU6500_SHADOW_PWR_MGMT_1 && MPU6500_SHADOW_PWR_MGMT_1 <= last){
+                // DEVICE_RESET self-clears, it is not a configuration bit
+                readback[MPU6500_SHADOW_PWR_MGMT_1 - first] |= (hmpu->shadow[MPU6500_SHADOW_PWR_MGMT_1] & 0x80);
+            }
+            if(memcmp(readback, &hmpu->shadow[first], last - first + 1) != 0) return HAL_ERROR;
+        }
+#endif
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Reload the register shadow from the sensor
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads the shadowed registers in 4 block transfers.
+ */
+HAL_StatusTypeDef MPU6500_SyncShadow(MPU6500_Handle *hmpu){
+    HAL_StatusTypeDef status;
+    uint8_t i;
+
+    hmpu->shadow_dirty = 0;
+
+    for(i = 0; i < sizeof(mpu6500_shadow_blocks) / sizeof(mpu6500_shadow_blocks[0]); i++){
+        status = MPU6500_ReadRegisters(hmpu, mpu6500_shadow_blocks[i].reg,
+                                       &hmpu->shadow[mpu6500_shadow_blocks[i].slot], mpu6500_shadow_blocks[i].len);
+        if(status != HAL_OK) return status;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Compare the register shadow with the sensor
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK if every shadowed register matches,
+ *         HAL_ERROR on a mismatch, bus error otherwise
+ */
+HAL_StatusTypeDef MPU6500_CheckShadow(MPU6500_Handle *hmpu){
+    HAL_StatusTypeDef status;
+    uint8_t actual[MPU6500_SHADOW_COUNT];
+    uint8_t i;
+
+    for(i = 0; i < sizeof(mpu6500_shadow_blocks) / sizeof(mpu6500_shadow_blocks[0]); i++){
+        status = MPU6500_ReadRegisters(hmpu, mpu6500_shadow_blocks[i].reg,
+                                       &actual[mpu6500_shadow_blocks[i].slot], mpu6500_shadow_blocks[i].len);
+        if(status != HAL_OK) return status;
+    }
+    // DEVICE_RESET self-clears, it is not a configuration bit
+    actual[MPU6500_SHADOW_PWR_MGMT_1] |= (hmpu->shadow[MPU6500_SHADOW_PWR_MGMT_1] & 0x80);
+    for(i = 0; i < MPU6500_SHADOW_COUNT; i++){
+        if(!(hmpu->shadow_dirty & (1U << i)) && actual[i] != hmpu->shadow[i]) return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Reset the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static inline HAL_StatusTypeDef MPU6500_Reset(MPU6500_Handle *hmpu){
+    HAL_StatusTypeDef status;
+    uint8_t data = 0x80; // DEVICE_RESET[7]
+    status = MPU6500_BusWrite(hmpu, PWR_MGMT_1, &data, 1);
+    if(status != HAL_OK) return status;
+    // All registers return to their reset values
+    memset(hmpu->shadow, 0, sizeof(hmpu->shadow));
+    hmpu->shadow[MPU6500_SHADOW_PWR_MGMT_1] = 0x40; // SLEEP[6]
+    hmpu->shadow_dirty = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief Configure the clock source of the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static inline HAL_StatusTypeDef MPU6500_ConfigureClock(MPU6500_Handle *hmpu){
+    return MPU6500_WriteRegister(hmpu, PWR_MGMT_1, 0x01); // SLEEP[6] | CLKSEL[2:0]
+}
+
+/**
+ * @brief Stage the accelerometer configuration
+ * @param hmpu Pointer to the MPU6500 handle
+ * @note Configuration sequence (written by MPU6500_CommitConfig):
+ *       1. Configure accelerometer full scale range
+ *       2. Configure accelerometer low pass filter
+ */
+static inline void MPU6500_ConfigureAccel(MPU6500_Handle *hmpu){
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_ACCEL_CONFIG, 0xFF, hmpu->accel_fs); // ACCEL_FS_SEL[4:3], bits [2:0] reserved (0)
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_ACCEL_CONFIG_2, 0xFF, MPU6500_DEFAULT_ACCEL_DLPF); // ACCEL_FCHOICE_B[3] = 0 | A_DLPF_CFG[2:0]
+}
+
+/**
+ * @brief Stage the gyroscope configuration
+ * @param hmpu Pointer to the MPU6500 handle
+ * @note Configuration sequence (written by MPU6500_CommitConfig):
+ *       1. Configure gyroscope full scale range
+ *       2. Configure gyroscope low pass filter
+ */
+static inline void MPU6500_ConfigureGyro(MPU6500_Handle *hmpu){
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_GYRO_CONFIG, 0xFF, hmpu->gyro_fs); // GYRO_FS_SEL[4:3] | FCHOICE_B[1:0] = 00
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_CONFIG, 0xFF, MPU6500_DEFAULT_GYRO_DLPF); // DLPF_CFG[2:0], default 20 Hz bandwidth at 1 kHz
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_SMPLRT_DIV, 0xFF, MPU6500_DEFAULT_SMPLRT_DIV); // ODR = 1 kHz / (1 + SMPLRT_DIV)
+}
+
+/**
+ * @brief Disable the gyroscope of the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static inline HAL_StatusTypeDef MPU6500_DisableGyro(MPU6500_Handle *hmpu){
+    return MPU6500_WriteRegister(hmpu, PWR_MGMT_2, 0x07); // DISABLE_XG[2]|DISABLE_YG[1]|DISABLE_ZG[0]
+}
+
+/**
+ * @brief Enable the temperature sensor of the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static inline HAL_StatusTypeDef MPU6500_EnableTemperatureSensor(MPU6500_Handle *hmpu){
+    // Clear TEMP_DIS bit (bit 4)
+    return MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_PWR_MGMT_1, (1 << 4), 0);
+}
+
+/**
+ * @brief Disable the temperature sensor of the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static inline HAL_StatusTypeDef MPU6500_DisableTemperatureSensor(MPU6500_Handle *hmpu){
+    // Set TEMP_DIS bit (bit 4)
+    return MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_PWR_MGMT_1, 0, (1 << 4));
+}   
+
+/**
+ * @brief Configure the interrupt pin
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */ 
+static inline HAL_StatusTypeDef MPU6500_ConfigureInterrupts(MPU6500_Handle *hmpu){
+    HAL_StatusTypeDef status;
+    status = MPU6500_WriteRegister(hmpu, INT_PIN_CFG, 0xB0); // ACTL[7] | OPEN[6] | LATCH_INT_EN[5] | INT_ANYRD_2CLEAR[4]
+    if(status != HAL_OK) return status;
+    return HAL_OK;
+}
+
+/**
+ * @brief Initialize the MPU6500 accelerometer
+ * @param hmpu Pointer to the MPU6500 handle to initialize
+ * @param bus Bus transport the sensor is connected to
+ * @param address 7-bit I2C address (MPU6500_ADDR_AD0_LOW/HIGH), ignored on SPI
+ * @return HAL_StatusTypeDef HAL_OK on success, error code on failure
+ * @note Configuration sequence:
+ *       1. Reset device
+ *       2. Wake up and configure clock
+ *       3. Configure accelerometer (MPU6500_DEFAULT_ACCEL_CONFIG, 20Hz bandwidth)
+ *       4. Configure gyroscope (MPU6500_DEFAULT_GYRO_CONFIG, 20Hz bandwidth)
+ *       5. Enable temperature sensor
+ *       6. Configure interrupt pin
+ */
+HAL_StatusTypeDef MPU6500_Init(MPU6500_Handle *hmpu, const MPU6500_Transport *bus, uint8_t address){
+    HAL_StatusTypeDef status;
+    if(hmpu == NULL || bus == NULL) return HAL_ERROR;
+    if(bus->read == NULL || bus->write == NULL || bus->delay == NULL) return HAL_ERROR;
+    memset(hmpu, 0, sizeof(*hmpu));
+    hmpu->bus = bus;
+    hmpu->address = address;
+    hmpu->accel_fs = MPU6500_DEFAULT_ACCEL_CONFIG;
+    hmpu->gyro_fs = MPU6500_DEFAULT_GYRO_CONFIG;
+    hmpu->accel_sens = mpu6500_accel_sens[hmpu->accel_fs >> 3];
+    hmpu->gyro_sens = mpu6500_gyro_sens[hmpu->gyro_fs >> 3];
+    hmpu->accel_scale = mpu6500_accel_scale[hmpu->accel_fs >> 3];
+    hmpu->gyro_scale = mpu6500_gyro_scale[hmpu->gyro_fs >> 3];
+    hmpu->autorange.accel_target = hmpu->accel_fs;
+    hmpu->autorange.gyro_target = hmpu->gyro_fs;
+    hmpu->read_timeout = MPU6500_DEFAULT_READ_TIMEOUT;
+    hmpu->write_timeout = MPU6500_DEFAULT_WRITE_TIMEOUT;
+    hmpu->retry.max_retries = MPU6500_DEFAULT_RETRIES;
+    hmpu->retry.backoff_ms = MPU6500_DEFAULT_BACKOFF_MS;
+    hmpu->retry.backoff_max_ms = MPU6500_DEFAULT_BACKOFF_MAX_MS;
+    // 1. Reset device
+    status = MPU6500_Reset(hmpu);
+    if (status != HAL_OK) return status;
+    hmpu->bus->delay(100); // Wait for reset to complete
+    if(hmpu->bus->type == MPU6500_BUS_SPI){
+        // Lock the sensor to SPI so I2C-like traffic cannot switch it back
+        status = MPU6500_WriteRegister(hmpu, USER_CTRL, 0x10); // I2C_IF_DIS[4]
+        if(status != HAL_OK) return status;
+    }
+    // 2. Wake up device and select clock source
+    status = MPU6500_ConfigureClock(hmpu);
+    if(status != HAL_OK) return status;
+    // 3. Configure Accelerometer
+    MPU6500_ConfigureAccel(hmpu);
+    // 4. Configure Gyroscope
+    MPU6500_ConfigureGyro(hmpu);
+    // Apply SMPLRT_DIV..ACCEL_CONFIG_2 in a single burst write
+    status = MPU6500_CommitConfig(hmpu);
+    if(status != HAL_OK) return status;
+    // 5. Enable temperature sensor
+    status = MPU6500_EnableTemperatureSensor(hmpu);
+    if(status != HAL_OK) return status; 
+    // 6. Configure INT Pin (but don't enable interrupts yet)
+    status = MPU6500_ConfigureInterrupts(hmpu);
+    if(status != HAL_OK) return status;
+    return HAL_OK;
+}
+
+/**
+ * @brief Set the timeouts of blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param read_ms Timeout of data reads in ms
+ * @param write_ms Timeout of configuration writes in ms
+ */
+void MPU6500_SetTimeouts(MPU6500_Handle *hmpu, uint32_t read_ms, uint32_t write_ms){
+    hmpu->read_timeout = read_ms;
+    hmpu->write_timeout = write_ms;
+}
+
+/**
+ * @brief Set the retry policy of blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param policy Retry count and backoff delays
+ */
+void MPU6500_SetRetryPolicy(MPU6500_Handle *hmpu, const MPU6500_RetryPolicy *policy){
+    hmpu->retry = *policy;
+}
+
+/**
+ * @brief Write the stored hardware offsets to the offset registers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sensors MPU6500_OFFSET_xxx to write
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static HAL_StatusTypeDef MPU6500_WriteOffsetRegisters(MPU6500_Handle *hmpu, uint8_t sensors){
+    static const uint8_t accel_regs[3] = { XA_OFFSET_H, YA_OFFSET_H, ZA_OFFSET_H };
+    HAL_StatusTypeDef status;
+    uint8_t buffer[6], i;
+
+    if(sensors & MPU6500_OFFSET_GYRO){
+        for(i = 0; i < 3; i++){
+            buffer[2 * i] = (uint8_t)((uint16_t)hmpu->hw_offset.gyro[i] >> 8);
+            buffer[2 * i + 1] = (uint8_t)hmpu->hw_offset.gyro[i];
+        }
+        // XG_OFFSET_H..ZG_OFFSET_L are contiguous
+        status = MPU6500_BusWrite(hmpu, XG_OFFSET_H, buffer, 6);
+        if(status != HAL_OK) return status;
+    }
+    if(sensors & MPU6500_OFFSET_ACCEL){
+        // XA/YA/ZA pairs are separated by reserved registers, one write each
+        for(i = 0; i < 3; i++){
+            buffer[0] = (uint8_t)((uint16_t)hmpu->hw_offset.accel[i] >> 8);
+            buffer[1] = (uint8_t)hmpu->hw_offset.accel[i];
+            status = MPU6500_BusWrite(hmpu, accel_regs[i], buffer, 2);
+            if(status != HAL_OK) return status;
+        }
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Check that the sensor still holds its configuration
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK if the sensor is configured (again),
+ *         error if it could not be read or restored
+ */
+HAL_StatusTypeDef MPU6500_CheckHealth(MPU6500_Handle *hmpu){
+    HAL_StatusTypeDef status;
+    uint8_t value;
+
+    status = MPU6500_ReadRegister(hmpu, PWR_MGMT_1, &value);
+    if(status != HAL_OK) return status;
+    if(value == hmpu->shadow[MPU6500_SHADOW_PWR_MGMT_1]) return HAL_OK;
+
+    // Sensor went through a power-on reset: write the whole shadow back.
+    // On SPI this also sets I2C_IF_DIS again (USER_CTRL is shadowed).
+    hmpu->stats.restores++;
+    hmpu->shadow_dirty = (uint16_t)((1U << MPU6500_SHADOW_COUNT) - 1U);
+    if(hmpu->fifo.frame_size != 0) hmpu->fifo.resync = 1;  // FIFO contents were lost
+    status = MPU6500_CommitConfig(hmpu);
+    if(status != HAL_OK) return status;
+    return MPU6500_WriteOffsetRegisters(hmpu, hmpu->hw_offset.sensors);
+}
+
+/**
+ * @brief Estimate how long a register read takes on the bus
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param len Number of data bytes
+ * @return uint32_t Estimated duration in µs, including MPU6500_XFER_OVERHEAD_US
+ */
+uint32_t MPU6500_EstimateReadTime(MPU6500_Handle *hmpu, uint16_t len){
+    uint32_t bits;
+
+    if(hmpu->bus->type == MPU6500_BUS_SPI){
+        bits = 8U * (1U + len);             // Address byte + data
+    } else {
+        bits = 9U * (3U + len) + 3U;        // Addr+W, reg, Addr+R, data, START/Sr/STOP
+    }
+    if(hmpu->bus->clock_hz == 0) return UINT32_MAX;
+    return (uint32_t)(((uint64_t)bits * 1000000U + hmpu->bus->clock_hz - 1) / hmpu->bus->clock_hz) + MPU6500_XFER_OVERHEAD_US;
+}
+
+/**
+ * @brief Get the bus event counters
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return const MPU6500_Stats* Counters of this sensor
+ */
+const MPU6500_Stats *MPU6500_GetStats(MPU6500_Handle *hmpu){
+    return &hmpu->stats;
+}
+
+/**
+ * @brief Enable data ready interrupts from the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Enables RAW_RDY_EN bit in INT_ENABLE register
+ */
+HAL_StatusTypeDef MPU6500_EnableDataReadyInterrupts(MPU6500_Handle *hmpu){
+    return MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_INT_ENABLE, 0, 0x01); // RAW_RDY_EN[0]
+}
+
+/**
+ * @brief Disable data ready interrupts from the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Disables RAW_RDY_EN bit in INT_ENABLE register
+ */
+HAL_StatusTypeDef MPU6500_DisableDataReadyInterrupts(MPU6500_Handle *hmpu){
+    return MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_INT_ENABLE, 0x01, 0); // RAW_RDY_EN[0]
+}
+
+/**
+ * @brief Read the WHO_AM_I register of the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param whoami Pointer to store the value read from WHO_AM_I register
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_ReadWhoAmI(MPU6500_Handle *hmpu, uint8_t *whoami){  
+    return MPU6500_ReadRegister(hmpu, WHO_AM_I, whoami);
+}
+
+HAL_StatusTypeDef MPU6500_ReadRawAccel(MPU6500_Handle *hmpu, int16_t *x, int16_t *y, int16_t *z){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[6];  // 6 bytes for data
+    // Read all 6 bytes starting from ACCEL_XOUT_H
+    status = MPU6500_ReadRegisters(hmpu, ACCEL_XOUT_H, buffer, 6);
+    if(status != HAL_OK) return status;
+    // Combine bytes into 16-bit values (high byte first, then low byte)
+    *x = (int16_t)((buffer[0] << 8) | buffer[1]);
+    *y = (int16_t)((buffer[2] << 8) | buffer[3]);
+    *z = (int16_t)((buffer[4] << 8) | buffer[5]);
+    return HAL_OK;
+}   
+
+/**
+ * @brief Read gyroscope data from MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param x Pointer to store X-axis gyroscope data
+ * @param y Pointer to store Y-axis gyroscope data
+ * @param z Pointer to store Z-axis gyroscope data
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 6 bytes starting from GYRO_XOUT_H register
+ *       Data is in 16-bit format, high byte first
+ */
+HAL_StatusTypeDef MPU6500_ReadRawGyro(MPU6500_Handle *hmpu, int16_t *x, int16_t *y, int16_t *z){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[6];  // 6 bytes for data
+    // Read all 6 bytes starting from GYRO_XOUT_H
+    status = MPU6500_ReadRegisters(hmpu, GYRO_XOUT_H, buffer, 6);
+    if(status != HAL_OK) return status;
+    // Combine bytes into 16-bit values (high byte first, then low byte)
+    *x = (int16_t)((buffer[0] << 8) | buffer[1]);
+    *y = (int16_t)((buffer[2] << 8) | buffer[3]);
+    *z = (int16_t)((buffer[4] << 8) | buffer[5]);
+    return HAL_OK;
+}       
+
+/**
+ * @brief Read accelerometer data from MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param x Pointer to store X-axis acceleration in g
+ * @param y Pointer to store Y-axis acceleration in g
+ * @param z Pointer to store Z-axis acceleration in g
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 6 bytes starting from ACCEL_XOUT_H register
+ *       Converts raw data to physical units using configured sensitivity
+ */
+HAL_StatusTypeDef MPU6500_ReadAccel(MPU6500_Handle *hmpu, float *x, float *y, float *z){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[6];  // 6 bytes for data
+    int16_t raw_x, raw_y, raw_z;
+    
+    // Read all 6 bytes starting from ACCEL_XOUT_H
+    status = MPU6500_ReadRegisters(hmpu, ACCEL_XOUT_H, buffer, 6);
+    if(status != HAL_OK) return status;
+    
+    // Combine bytes into 16-bit values (high byte first, then low byte)
+    raw_x = (int16_t)((buffer[0] << 8) | buffer[1]) - hmpu->accel_offset[0];
+    raw_y = (int16_t)((buffer[2] << 8) | buffer[3]) - hmpu->accel_offset[1];
+    raw_z = (int16_t)((buffer[4] << 8) | buffer[5]) - hmpu->accel_offset[2];
+    
+    // Convert to physical units (g)
+    *x = (float)raw_x * hmpu->accel_scale;
+    *y = (float)raw_y * hmpu->accel_scale;
+    *z = (float)raw_z * hmpu->accel_scale;
+    
+    return HAL_OK;
+}
+
+/**
+ * @brief Read gyroscope data from MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param x Pointer to store X-axis gyroscope data in degrees per second
+ * @param y Pointer to store Y-axis gyroscope data in degrees per second
+ * @param z Pointer to store Z-axis gyroscope data in degrees per second
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 6 bytes starting from GYRO_XOUT_H register
+ *       Converts raw data to physical units using configured sensitivity
+ */
+HAL_StatusTypeDef MPU6500_ReadGyro(MPU6500_Handle *hmpu, float *x, float *y, float *z){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[6];  // 6 bytes for data
+    int16_t raw_x, raw_y, raw_z;
+    
+    // Read all 6 bytes starting from GYRO_XOUT_H
+    status = MPU6500_ReadRegisters(hmpu, GYRO_XOUT_H, buffer, 6);
+    if(status != HAL_OK) return status;
+    
+    // Combine bytes into 16-bit values (high byte first, then low byte)
+    raw_x = (int16_t)((buffer[0] << 8) | buffer[1]) - hmpu->gyro_offset[0];
+    raw_y = (int16_t)((buffer[2] << 8) | buffer[3]) - hmpu->gyro_offset[1];
+    raw_z = (int16_t)((buffer[4] << 8) | buffer[5]) - hmpu->gyro_offset[2];
+    
+    // Convert to physical units (degrees per second)
+    *x = (float)raw_x * hmpu->gyro_scale;
+    *y = (float)raw_y * hmpu->gyro_scale;
+    *z = (float)raw_z * hmpu->gyro_scale;
+    
+    return HAL_OK;
+}
+
+/**
+ * @brief Read temperature data from MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param[out] temp Pointer to store the raw temperature value (signed 16-bit)
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 2 bytes from TEMP_OUT_H and TEMP_OUT_L.
+ *       The value is in 16-bit signed format (big endian).
+ *       Conversion to Celsius: Temp(°C) = temp / 333.87 + 21
+ */
+HAL_StatusTypeDef MPU6500_ReadTemp(MPU6500_Handle *hmpu, int16_t *temp){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[2];
+
+    // Read 2 bytes starting from TEMP_OUT_H
+    status = MPU6500_ReadRegisters(hmpu, TEMP_OUT_H, buffer, 2);
+    if (status != HAL_OK) return status;
+
+    // Combine bytes into signed 16-bit integer
+    *temp = (int16_t)((buffer[0] << 8) | buffer[1]);
+
+    return HAL_OK;
+}
+
+/**
+ * @brief Decode a 14-byte ACCEL_XOUT_H..GYRO_ZOUT_L frame
+ * @param buffer Raw register bytes, high byte first
+ * @param sample Pointer to store the raw sensor frame
+ */
+static inline void MPU6500_ParseRawSample(const uint8_t *buffer, MPU6500_RawSample *sample){
+    sample->accel[0] = (int16_t)((buffer[0] << 8) | buffer[1]);
+    sample->accel[1] = (int16_t)((buffer[2] << 8) | buffer[3]);
+    sample->accel[2] = (int16_t)((buffer[4] << 8) | buffer[5]);
+    sample->temp     = (int16_t)((buffer[6] << 8) | buffer[7]);
+    sample->gyro[0]  = (int16_t)((buffer[8] << 8) | buffer[9]);
+    sample->gyro[1]  = (int16_t)((buffer[10] << 8) | buffer[11]);
+    sample->gyro[2]  = (int16_t)((buffer[12] << 8) | buffer[13]);
+}
+
+/**
+ * @brief Track saturation of one sensor for auto-ranging
+ * @param raw Raw X/Y/Z values
+ * @param fs Active full scale (MPU6500_xxx_FS_xxx)
+ * @param target Range to switch to, updated when a step is due
+ * @param quiet Counter of consecutive samples below MPU6500_AUTORANGE_LOW
+ */
+static inline void MPU6500_AutoRangeCheck(const int16_t raw[3], uint8_t fs, uint8_t *target, uint16_t *quiet){
+    uint8_t i;
+    int32_t value, peak = 0;
+
+    for(i = 0; i < 3; i++){
+        value = raw[i];
+        if(value < 0) value = -value;
+        if(value > peak) peak = value;
+    }
+    if(peak >= MPU6500_AUTORANGE_HIGH){
+        *quiet = 0;
+        if(fs < 0x18) *target = fs + 0x08;                  // Next coarser range
+    }else if(peak < MPU6500_AUTORANGE_LOW && fs > 0){
+        if(++*quiet >= MPU6500_AUTORANGE_HOLD){
+            *quiet = 0;
+            *target = fs - 0x08;                            // Next finer range
+        }
+    }else{
+        *quiet = 0;
+    }
+}
+
+/**
+ * @brief Run the auto-ranging checks on a sensor frame
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param raw Raw sensor frame
+ * @return uint8_t 1 if the frame may predate the last range switch, else 0
+ */
+static inline uint8_t MPU6500_AutoRangeTrack(MPU6500_Handle *hmpu, const MPU6500_RawSample *raw){
+    if(hmpu->autorange.settle != 0){
+        // Frame may predate the range switch, it cannot drive the next one
+        hmpu->autorange.settle--;
+        return 1;
+    }
+    if(hmpu->autorange.sensors & MPU6500_AUTORANGE_ACCEL){
+        MPU6500_AutoRangeCheck(raw->accel, hmpu->accel_fs, &hmpu->autorange.accel_target, &hmpu->autorange.accel_quiet);
+    }
+    if(hmpu->autorange.sensors & MPU6500_AUTORANGE_GYRO){
+        MPU6500_AutoRangeCheck(raw->gyro, hmpu->gyro_fs, &hmpu->autorange.gyro_target, &hmpu->autorange.gyro_quiet);
+    }
+    return 0;
+}
+
+/**
+ * @brief Apply offsets to a raw frame and convert it to physical units
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param raw Raw sensor frame
+ * @param sample Pointer to store the converted sensor frame
+ */
+static inline void MPU6500_ConvertSample(MPU6500_Handle *hmpu, const MPU6500_RawSample *raw, MPU6500_Sample *sample){
+    const int16_t *accel_offset = hmpu->accel_offset, *gyro_offset = hmpu->gyro_offset;
+    float accel_scale = hmpu->accel_scale, gyro_scale = hmpu->gyro_scale;
+    uint8_t i;
+
+    sample->accel_fs = hmpu->accel_fs;
+    sample->gyro_fs = hmpu->gyro_fs;
+    if(hmpu->autorange.settle != 0){
+        // Frame may predate the range switch: convert it as taken at the old range
+        sample->accel_fs = hmpu->autorange.prev_accel_fs;
+        sample->gyro_fs = hmpu->autorange.prev_gyro_fs;
+        accel_offset = hmpu->autorange.prev_accel_offset;
+        gyro_offset = hmpu->autorange.prev_gyro_offset;
+        accel_scale = mpu6500_accel_scale[sample->accel_fs >> 3];
+        gyro_scale = mpu6500_gyro_scale[sample->gyro_fs >> 3];
+    }
+    for(i = 0; i < 3; i++){
+        sample->accel[i] = (float)(int16_t)(raw->accel[i] - accel_offset[i]) * accel_scale;
+        sample->gyro[i]  = (float)(int16_t)(raw->gyro[i] - gyro_offset[i]) * gyro_scale;
+    }
+    sample->temp = (float)raw->temp / MPU6500_TEMP_SENS + MPU6500_TEMP_OFFSET;
+    sample->settling = MPU6500_AutoRangeTrack(hmpu, raw);
+}
+
+/**
+ * @brief Write the full scale ranges requested by auto-ranging
+ * @param hmpu Pointer to the MPU6500 handle
+ * @note A failed write leaves the request pending for the next sample.
+ */
+static void MPU6500_AutoRangeApply(MPU6500_Handle *hmpu){
+    if(hmpu->autorange.accel_target == hmpu->accel_fs && hmpu->autorange.gyro_target == hmpu->gyro_fs) return;
+    if(MPU6500_SetFullScale(hmpu, hmpu->autorange.accel_target, hmpu->autorange.gyro_target) == HAL_OK){
+        hmpu->stats.range_switches++;
+    }
+}
+
+/**
+ * @brief Read raw accelerometer, temperature and gyroscope data in one transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sample Pointer to store the raw sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 14 bytes starting from ACCEL_XOUT_H register, so all seven
+ *       channels belong to the same sample instant. Offsets are not applied.
+ */
+HAL_StatusTypeDef MPU6500_ReadRawAll(MPU6500_Handle *hmpu, MPU6500_RawSample *sample){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[MPU6500_SAMPLE_SIZE];
+
+    // Read all 14 bytes starting from ACCEL_XOUT_H
+    status = MPU6500_ReadRegisters(hmpu, ACCEL_XOUT_H, buffer, MPU6500_SAMPLE_SIZE);
+    if(status != HAL_OK) return status;
+
+    MPU6500_ParseRawSample(buffer, sample);
+    return HAL_OK;
+}
+
+/**
+ * @brief Read accelerometer, temperature and gyroscope data in one transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sample Pointer to store the converted sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 14 bytes starting from ACCEL_XOUT_H register, subtracts the
+ *       calibration offsets and converts to g, °/s and °C.
+ *       Replaces a ReadAccel + ReadGyro + ReadTemp sequence (3 transfers).
+ */
+HAL_StatusTypeDef MPU6500_ReadAll(MPU6500_Handle *hmpu, MPU6500_Sample *sample){
+    HAL_StatusTypeDef status;
+    MPU6500_RawSample raw;
+
+    status = MPU6500_ReadRawAll(hmpu, &raw);
+    if(status != HAL_OK) return status;
+
+    MPU6500_ConvertSample(hmpu, &raw, sample);
+    MPU6500_AutoRangeApply(hmpu);
+    return HAL_OK;
+}
+
+/**
+ * @brief Read the sensor frame only if it can complete within a time budget
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sample Pointer to store the converted sensor frame
+ * @param budget_us Time the caller can spend in this call (µs)
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_TIMEOUT if the deadline
+ *         cannot be met or the transfer timed out, error on failure
+ */
+HAL_StatusTypeDef MPU6500_ReadAllWithin(MPU6500_Handle *hmpu, MPU6500_Sample *sample, uint32_t budget_us){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[MPU6500_SAMPLE_SIZE];
+    MPU6500_RawSample raw;
+
+    if(MPU6500_EstimateReadTime(hmpu, MPU6500_SAMPLE_SIZE) > budget_us){
+        hmpu->stats.deadline_skips++;
+        return HAL_TIMEOUT;
+    }
+    status = MPU6500_BusRead(hmpu, ACCEL_XOUT_H, buffer, MPU6500_SAMPLE_SIZE, &budget_us);
+    if(status != HAL_OK) return status;
+
+    MPU6500_ParseRawSample(buffer, &raw);
+    MPU6500_ConvertSample(hmpu, &raw, sample);
+    // A range switch writes GYRO_CONFIG..ACCEL_CONFIG, else it waits for the next read
+    if(budget_us >= MPU6500_EstimateReadTime(hmpu, 2)) MPU6500_AutoRangeApply(hmpu);
+    return HAL_OK;
+}
+
+/**
+ * @brief Read INT_STATUS and the raw sensor frame in one transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param int_status Pointer to store the interrupt flags (MPU6500_INT_xxx)
+ * @param sample Pointer to store the raw sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 15 bytes starting from INT_STATUS register. With
+ *       INT_ANYRD_2CLEAR set by MPU6500_Init, this read also clears the
+ *       latched interrupt. Offsets are not applied.
+ */
+HAL_StatusTypeDef MPU6500_ReadRawAllWithStatus(MPU6500_Handle *hmpu, uint8_t *int_status, MPU6500_RawSample *sample){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[1 + MPU6500_SAMPLE_SIZE];
+
+    // INT_STATUS (0x3A) directly precedes ACCEL_XOUT_H (0x3B)
+    status = MPU6500_ReadRegisters(hmpu, INT_STATUS, buffer, sizeof(buffer));
+    if(status != HAL_OK) return status;
+
+    *int_status = buffer[0];
+    // Reading INT_STATUS clears it, so keep an overflow for the next FIFO drain
+    if((buffer[0] & MPU6500_INT_FIFO_OFLOW) && hmpu->fifo.frame_size != 0 && !hmpu->fifo.resync){
+        hmpu->stats.fifo_overflows++;
+        hmpu->fifo.resync = 1;
+    }
+    MPU6500_ParseRawSample(&buffer[1], sample);
+    return HAL_OK;
+}
+
+/**
+ * @brief Read INT_STATUS and the sensor frame in one transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param int_status Pointer to store the interrupt flags (MPU6500_INT_xxx)
+ * @param sample Pointer to store the converted sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note The sample is only meaningful when MPU6500_INT_RAW_DATA_RDY is set.
+ */
+HAL_StatusTypeDef MPU6500_ReadAllWithStatus(MPU6500_Handle *hmpu, uint8_t *int_status, MPU6500_Sample *sample){
+    HAL_StatusTypeDef status;
+    MPU6500_RawSample raw;
+
+    status = MPU6500_ReadRawAllWithStatus(hmpu, int_status, &raw);
+    if(status != HAL_OK) return status;
+
+    MPU6500_ConvertSample(hmpu, &raw, sample);
+    MPU6500_AutoRangeApply(hmpu);
+    return HAL_OK;
+}
+
+/**
+ * @brief Scale a raw value by a fixed-point coefficient
+ * @param raw Raw value, offsets already applied
+ * @param coef Output units per LSB, Q16
+ * @return int32_t raw * coef / 65536, rounded half up
+ * @note The coefficient is split into integer and fraction parts so both
+ *       products fit 32 bits (|raw| <= 32768, fraction < 65536): no 64-bit
+ *       multiply on Cortex-M0+. Relies on arithmetic right shift of negative
+ *       values, as GCC, Clang and ARMCC implement it.
+ */
+static inline int32_t MPU6500_FixedScale(int32_t raw, uint32_t coef){
+    return raw * (int32_t)(coef >> 16) + ((raw * (int32_t)(coef & 0xFFFF) + 0x8000) >> 16);
+}
+
+/**
+ * @brief Read accelerometer data as fixed-point values
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param format MPU6500_FIXED_Q16 (Q16.16 g) or MPU6500_FIXED_MILLI (mg)
+ * @param x Pointer to store X-axis acceleration
+ * @param y Pointer to store Y-axis acceleration
+ * @param z Pointer to store Z-axis acceleration
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_ReadAccelFixed(MPU6500_Handle *hmpu, uint8_t format, int32_t *x, int32_t *y, int32_t *z){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[6];
+    uint32_t coef;
+
+    if(format > MPU6500_FIXED_MILLI) return HAL_ERROR;
+    status = MPU6500_ReadRegisters(hmpu, ACCEL_XOUT_H, buffer, 6);
+    if(status != HAL_OK) return status;
+
+    coef = mpu6500_accel_fixed[format][hmpu->accel_fs >> 3];
+    *x = MPU6500_FixedScale((int16_t)(((buffer[0] << 8) | buffer[1]) - hmpu->accel_offset[0]), coef);
+    *y = MPU6500_FixedScale((int16_t)(((buffer[2] << 8) | buffer[3]) - hmpu->accel_offset[1]), coef);
+    *z = MPU6500_FixedScale((int16_t)(((buffer[4] << 8) | buffer[5]) - hmpu->accel_offset[2]), coef);
+    return HAL_OK;
+}
+
+/**
+ * @brief Read gyroscope data as fixed-point values
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param format MPU6500_FIXED_Q16 (Q16.16 °/s) or MPU6500_FIXED_MILLI (m°/s)
+ * @param x Pointer to store X-axis angular rate
+ * @param y Pointer to store Y-axis angular rate
+ * @param z Pointer to store Z-axis angular rate
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_ReadGyroFixed(MPU6500_Handle *hmpu, uint8_t format, int32_t *x, int32_t *y, int32_t *z){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[6];
+    uint32_t coef;
+
+    if(format > MPU6500_FIXED_MILLI) return HAL_ERROR;
+    status = MPU6500_ReadRegisters(hmpu, GYRO_XOUT_H, buffer, 6);
+    if(status != HAL_OK) return status;
+
+    coef = mpu6500_gyro_fixed[format][hmpu->gyro_fs >> 3];
+    *x = MPU6500_FixedScale((int16_t)(((buffer[0] << 8) | buffer[1]) - hmpu->gyro_offset[0]), coef);
+    *y = MPU6500_FixedScale((int16_t)(((buffer[2] << 8) | buffer[3]) - hmpu->gyro_offset[1]), coef);
+    *z = MPU6500_FixedScale((int16_t)(((buffer[4] << 8) | buffer[5]) - hmpu->gyro_offset[2]), coef);
+    return HAL_OK;
+}
+
+/**
+ * @brief Read accelerometer, temperature and gyroscope data as fixed-point values
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param format MPU6500_FIXED_Q16 or MPU6500_FIXED_MILLI
+ * @param sample Pointer to store the converted sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_ReadAllFixed(MPU6500_Handle *hmpu, uint8_t format, MPU6500_FixedSample *sample){
+    HAL_StatusTypeDef status;
+    MPU6500_RawSample raw;
+    const int16_t *accel_offset = hmpu->accel_offset, *gyro_offset = hmpu->gyro_offset;
+    uint32_t accel_coef, gyro_coef;
+    uint8_t i;
+
+    if(format > MPU6500_FIXED_MILLI) return HAL_ERROR;
+    status = MPU6500_ReadRawAll(hmpu, &raw);
+    if(status != HAL_OK) return status;
+
+    sample->accel_fs = hmpu->accel_fs;
+    sample->gyro_fs = hmpu->gyro_fs;
+    if(hmpu->autorange.settle != 0){
+        // Same as MPU6500_ConvertSample: a settling frame uses the old range
+        sample->accel_fs = hmpu->autorange.prev_accel_fs;
+        sample->gyro_fs = hmpu->autorange.prev_gyro_fs;
+        accel_offset = hmpu->autorange.prev_accel_offset;
+        gyro_offset = hmpu->autorange.prev_gyro_offset;
+    }
+    accel_coef = mpu6500_accel_fixed[format][sample->accel_fs >> 3];
+    gyro_coef = mpu6500_gyro_fixed[format][sample->gyro_fs >> 3];
+    for(i = 0; i < 3; i++){
+        sample->accel[i] = MPU6500_FixedScale((int16_t)(raw.accel[i] - accel_offset[i]), accel_coef);
+        sample->gyro[i]  = MPU6500_FixedScale((int16_t)(raw.gyro[i] - gyro_offset[i]), gyro_coef);
+    }
+    sample->temp = MPU6500_FixedScale(raw.temp, mpu6500_temp_fixed[format]) + mpu6500_temp_fixed_offset[format];
+    sample->settling = MPU6500_AutoRangeTrack(hmpu, &raw);
+    MPU6500_AutoRangeApply(hmpu);
+    return HAL_OK;
+}
+
+/**
+ * @brief Issue the current non-blocking transfer step
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK if the step was started, error on failure
+ */
+static HAL_StatusTypeDef MPU6500_AsyncIssueStep(MPU6500_Handle *hmpu){
+    uint8_t step = hmpu->async.step;
+
+    return hmpu->bus->read_async(hmpu->bus->ctx, hmpu->address, mpu6500_async_steps[step].reg,
+                                 &hmpu->async.buffer[mpu6500_async_steps[step].offset],
+                                 mpu6500_async_steps[step].len, hmpu->async.mode);
+}
+
+/**
+ * @brief Pop the next pending step and issue it
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK if the step was started, error on failure
+ */
+static HAL_StatusTypeDef MPU6500_AsyncNextStep(MPU6500_Handle *hmpu){
+    uint8_t step = 0;
+
+    while(!(hmpu->async.pending & (1U << step))) step++;
+    hmpu->async.pending &= (uint8_t)~(1U << step);
+    hmpu->async.step = step;
+    hmpu->async.retries = 0;
+    return MPU6500_AsyncIssueStep(hmpu);
+}
+
+/**
+ * @brief Start a chain of non-blocking transfer steps
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param mode MPU6500_ASYNC_DMA or MPU6500_ASYNC_IT
+ * @param channels Combination of MPU6500_READ_xxx flags
+ * @return HAL_StatusTypeDef HAL_OK if the transfer was started,
+ *         HAL_BUSY if a transfer is already in progress, error on failure
+ */
+static HAL_StatusTypeDef MPU6500_AsyncStart(MPU6500_Handle *hmpu, uint8_t mode, uint8_t channels){
+    HAL_StatusTypeDef status;
+
+    // A burst read already covers every channel
+    if(channels & MPU6500_READ_BURST) channels = MPU6500_READ_BURST;
+    channels &= (MPU6500_READ_ACCEL | MPU6500_READ_TEMP | MPU6500_READ_GYRO | MPU6500_READ_BURST);
+    if(channels == 0 || hmpu->bus->read_async == NULL) return HAL_ERROR;
+    if(hmpu->async.state == MPU6500_ASYNC_BUSY) return HAL_BUSY;
+
+    memset(hmpu->async.buffer, 0, sizeof(hmpu->async.buffer));
+    hmpu->async.mode = mode;
+    hmpu->async.pending = channels;
+    hmpu->async.start_tick = HAL_GetTick();
+    hmpu->async.state = MPU6500_ASYNC_BUSY;
+    status = MPU6500_AsyncNextStep(hmpu);
+    if(status != HAL_OK){
+        hmpu->async.state = MPU6500_ASYNC_IDLE;
+        return status;
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Start a non-blocking 14-byte sensor frame read using DMA
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK if the transfer was started,
+ *         HAL_BUSY if a transfer is already in progress, error on failure
+ * @note Completion is reported through MPU6500_I2C_MemRxCpltCallback.
+ */
+HAL_StatusTypeDef MPU6500_StartReadAll_DMA(MPU6500_Handle *hmpu){
+    return MPU6500_AsyncStart(hmpu, MPU6500_ASYNC_DMA, MPU6500_READ_BURST);
+}
+
+/**
+ * @brief Start a non-blocking read using interrupt-driven transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param channels Combination of MPU6500_READ_xxx flags
+ * @return HAL_StatusTypeDef HAL_OK if the transfer was started,
+ *         HAL_BUSY if a transfer is already in progress, error on failure
+ * @note Steps are chained from MPU6500_I2C_MemRxCpltCallback.
+ */
+HAL_StatusTypeDef MPU6500_StartRead_IT(MPU6500_Handle *hmpu, uint8_t channels){
+    return MPU6500_AsyncStart(hmpu, MPU6500_ASYNC_IT, channels);
+}
+
+/**
+ * @brief Get the state of the non-blocking acquisition
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return MPU6500_AsyncState current state
+ */
+MPU6500_AsyncState MPU6500_GetAsyncState(MPU6500_Handle *hmpu){
+    return hmpu->async.state;
+}
+
+/**
+ * @brief Fetch the sample produced by the last non-blocking transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sample Pointer to store the converted sensor frame
+ * @return HAL_StatusTypeDef HAL_OK if a sample was copied, HAL_BUSY if the
+ *         transfer is still running, HAL_TIMEOUT if it overran the read
+ *         timeout, HAL_ERROR if it failed or none was started
+ */
+HAL_StatusTypeDef MPU6500_GetAsyncSample(MPU6500_Handle *hmpu, MPU6500_Sample *sample){
+    MPU6500_RawSample raw;
+
+    switch(hmpu->async.state){
+    case MPU6500_ASYNC_READY:
+        // Converted here rather than in the completion IRQ, which must not
+        // touch the auto-range state the blocking reads also update
+        MPU6500_ParseRawSample(hmpu->async.buffer, &raw);
+        MPU6500_ConvertSample(hmpu, &raw, sample);
+        hmpu->async.state = MPU6500_ASYNC_IDLE;
+        MPU6500_AutoRangeApply(hmpu);
+        return HAL_OK;
+    case MPU6500_ASYNC_BUSY:
+        if(HAL_GetTick() - hmpu->async.start_tick <= hmpu->read_timeout) return HAL_BUSY;
+        // Abandon the transfer, a late completion no longer matches the state.
+        // Stop it too, or the peripheral stays busy and refuses the next one.
+        hmpu->async.state = MPU6500_ASYNC_IDLE;
+        if(hmpu->bus->abort != NULL) hmpu->bus->abort(hmpu->bus->ctx, hmpu->address);
+        if(hmpu->bus->read_async_end != NULL) hmpu->bus->read_async_end(hmpu->bus->ctx);
+        hmpu->stats.timeouts++;
+        return HAL_TIMEOUT;
+    case MPU6500_ASYNC_ERROR:
+        hmpu->async.state = MPU6500_ASYNC_IDLE;
+        return HAL_ERROR;
+    default:
+        return HAL_ERROR;
+    }
+}
+
+/**
+ * @brief Completion hook for non-blocking transfers on any transport
+ * @param hmpu Pointer to the MPU6500 handle
+ * @note Issues the next pending step, or marks the frame ready once the
+ *       chain is complete.
+ */
+void MPU6500_AsyncCpltCallback(MPU6500_Handle *hmpu){
+    if(hmpu->async.state != MPU6500_ASYNC_BUSY) return;
+    if(hmpu->bus->read_async_end != NULL) hmpu->bus->read_async_end(hmpu->bus->ctx);
+    if(hmpu->async.pending != 0){
+        if(MPU6500_AsyncNextStep(hmpu) != HAL_OK) hmpu->async.state = MPU6500_ASYNC_ERROR;
+        return;
+    }
+    hmpu->async.state = MPU6500_ASYNC_READY;
+}
+
+/**
+ * @brief Error hook for non-blocking transfers on any transport
+ * @param hmpu Pointer to the MPU6500 handle
+ * @note A NACKed step is re-issued up to MPU6500_ASYNC_MAX_RETRIES times
+ *       before the transfer fails.
+ */
+void MPU6500_AsyncErrorCallback(MPU6500_Handle *hmpu){
+    MPU6500_BusError error;
+
+    if(hmpu->async.state != MPU6500_ASYNC_BUSY) return;
+    if(hmpu->bus->read_async_end != NULL) hmpu->bus->read_async_end(hmpu->bus->ctx);
+    error = MPU6500_CountError(hmpu, HAL_ERROR);
+    if(error == MPU6500_BUS_ERR_NACK && hmpu->async.retries < MPU6500_ASYNC_MAX_RETRIES){
+        hmpu->async.retries++;
+        if(MPU6500_AsyncIssueStep(hmpu) == HAL_OK) return;
+    }
+    hmpu->async.state = MPU6500_ASYNC_ERROR;
+}
+
+#ifdef HAL_I2C_MODULE_ENABLED
+/**
+ * @brief Completion hook for non-blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param hi2c I2C handle passed to HAL_I2C_MemRxCpltCallback
+ */
+void MPU6500_I2C_MemRxCpltCallback(MPU6500_Handle *hmpu, I2C_HandleTypeDef *hi2c){
+    if(hmpu->bus->type != MPU6500_BUS_I2C || hmpu->bus->ctx != hi2c) return;
+    MPU6500_AsyncCpltCallback(hmpu);
+}
+
+/**
+ * @brief Error hook for non-blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param hi2c I2C handle passed to HAL_I2C_ErrorCallback
+ */
+void MPU6500_I2C_ErrorCallback(MPU6500_Handle *hmpu, I2C_HandleTypeDef *hi2c){
+    if(hmpu->bus->type != MPU6500_BUS_I2C || hmpu->bus->ctx != hi2c) return;
+    MPU6500_AsyncErrorCallback(hmpu);
+}
+#endif
+
+#ifdef HAL_SPI_MODULE_ENABLED
+/**
+ * @brief Completion hook for non-blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param hspi SPI handle passed to HAL_SPI_RxCpltCallback
+ */
+void MPU6500_SPI_RxCpltCallback(MPU6500_Handle *hmpu, SPI_HandleTypeDef *hspi){
+    if(hmpu->bus->type != MPU6500_BUS_SPI || ((MPU6500_SPI_Bus *)hmpu->bus->ctx)->hspi != hspi) return;
+    MPU6500_AsyncCpltCallback(hmpu);
+}
+
+/**
+ * @brief Error hook for non-blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param hspi SPI handle passed to HAL_SPI_ErrorCallback
+ */
+void MPU6500_SPI_ErrorCallback(MPU6500_Handle *hmpu, SPI_HandleTypeDef *hspi){
+    if(hmpu->bus->type != MPU6500_BUS_SPI || ((MPU6500_SPI_Bus *)hmpu->bus->ctx)->hspi != hspi) return;
+    MPU6500_AsyncErrorCallback(hmpu);
+}
+#endif
+
+/* USER_CTRL bits used by the FIFO */
+#define MPU6500_USER_FIFO_EN    0x40
+#define MPU6500_USER_FIFO_RST   0x04
+
+/**
+ * @brief Discard the FIFO contents
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Reset(MPU6500_Handle *hmpu){
+    HAL_StatusTypeDef status;
+    // FIFO_RST self-clears, so it never enters the shadow
+    uint8_t data = (uint8_t)(hmpu->shadow[MPU6500_SHADOW_USER_CTRL] | MPU6500_USER_FIFO_RST);
+
+    status = MPU6500_BusWrite(hmpu, USER_CTRL, &data, 1);
+    if(status != HAL_OK) return status;
+    hmpu->fifo.resync = 0;
+    hmpu->fifo.backlog = 0;
+    hmpu->fifo.tick = HAL_GetTick();
+    hmpu->ts.valid = 0;     // Sample sequence restarts
+    return HAL_OK;
+}
+
+/**
+ * @brief Time between two samples at the configured output data rate
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return uint32_t Sample period in ns
+ * @note SMPLRT_DIV only applies to the 1 kHz internal rate (DLPF_CFG 1..6).
+ */
+static uint32_t MPU6500_SamplePeriodNs(MPU6500_Handle *hmpu){
+    uint8_t dlpf = hmpu->shadow[MPU6500_SHADOW_CONFIG] & 0x07;
+
+    if(hmpu->shadow[MPU6500_SHADOW_GYRO_CONFIG] & 0x03) return 31250;  // FCHOICE_B: 32 kHz
+    if(dlpf == 0 || dlpf == 7) return 125000;                           // 8 kHz
+    return 1000000U * (1U + hmpu->shadow[MPU6500_SHADOW_SMPLRT_DIV]);
+}
+
+/**
+ * @brief Follow a change of the output data rate in the timestamp filter
+ * @param hmpu Pointer to the MPU6500 handle
+ */
+static void MPU6500_UpdateSamplePeriod(MPU6500_Handle *hmpu){
+    uint32_t nominal = MPU6500_SamplePeriodNs(hmpu);
+
+    if(hmpu->ts.nominal_ns == nominal) return;
+    // New output data rate: the drift measured so far no longer applies
+    hmpu->ts.nominal_ns = nominal;
+    hmpu->ts.period_q16 = (uint64_t)nominal << 16;
+    hmpu->ts.drift_ns = 0;
+    hmpu->ts.drift_span = 0;
+    hmpu->ts.valid = 0;
+}
+
+/**
+ * @brief Reset the FIFO after frame alignment was lost and report the gap
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param batch Batch to report the resync in
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+static HAL_StatusTypeDef MPU6500_FIFO_Resync(MPU6500_Handle *hmpu, MPU6500_FIFO_Batch *batch){
+    HAL_StatusTypeDef status;
+    uint32_t lost = hmpu->fifo.backlog;
+    uint32_t elapsed = HAL_GetTick() - hmpu->fifo.tick;
+
+    // Everything left behind and everything sampled since is gone
+    lost += (uint32_t)(((uint64_t)elapsed * 1000000U) / MPU6500_SamplePeriodNs(hmpu));
+    status = MPU6500_FIFO_Reset(hmpu);
+    if(status != HAL_OK){
+        hmpu->fifo.resync = 1;      // Try again on the next drain
+        return status;
+    }
+
+    hmpu->stats.fifo_lost += lost;
+    batch->resync = 1;
+    batch->lost = lost;
+    return HAL_OK;
+}
+
+/**
+ * @brief Start streaming samples into the hardware FIFO
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param channels MPU6500_FIFO_ACCEL, MPU6500_FIFO_TEMP and/or MPU6500_FIFO_GYRO
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Enable(MPU6500_Handle *hmpu, uint8_t channels){
+    HAL_StatusTypeDef status;
+    uint8_t size = 0;
+
+    if(channels == 0 || (channels & ~MPU6500_FIFO_ALL)) return HAL_ERROR;
+    if(channels & MPU6500_FIFO_ACCEL) size += 6;
+    if(channels & MPU6500_FIFO_TEMP) size += 2;
+    if(channels & 0x40) size += 2;      // GYRO_XOUT
+    if(channels & 0x20) size += 2;      // GYRO_YOUT
+    if(channels & 0x10) size += 2;      // GYRO_ZOUT
+
+    // Stop and empty the FIFO, select the channels, then start it again
+    status = MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_USER_CTRL, MPU6500_USER_FIFO_EN, 0);
+    if(status != HAL_OK) return status;
+    status = MPU6500_FIFO_Reset(hmpu);
+    if(status != HAL_OK) return status;
+    status = MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_FIFO_EN, 0xFF, channels);
+    if(status != HAL_OK) return status;
+    status = MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_INT_ENABLE, 0, MPU6500_INT_FIFO_OFLOW);
+    if(status != HAL_OK) return status;
+    status = MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_USER_CTRL, 0, MPU6500_USER_FIFO_EN);
+    if(status != HAL_OK) return status;
+    hmpu->fifo.tick = HAL_GetTick();
+
+    hmpu->fifo.channels = channels;
+    hmpu->fifo.frame_size = size;
+    MPU6500_UpdateSamplePeriod(hmpu);
+    hmpu->ts.drift_ns = 0;
+    hmpu->ts.drift_span = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief Stop streaming samples into the hardware FIFO
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Disable(MPU6500_Handle *hmpu){
+    HAL_StatusTypeDef status;
+
+    status = MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_USER_CTRL, MPU6500_USER_FIFO_EN, 0);
+    if(status != HAL_OK) return status;
+    status = MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_FIFO_EN, 0xFF, 0);
+    if(status != HAL_OK) return status;
+    status = MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_INT_ENABLE, MPU6500_INT_FIFO_OFLOW, 0);
+    if(status != HAL_OK) return status;
+
+    hmpu->fifo.channels = 0;
+    hmpu->fifo.frame_size = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief Read the number of bytes waiting in the FIFO
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param count Pointer to store the byte count
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_FIFO_GetCount(MPU6500_Handle *hmpu, uint16_t *count){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[2];
+
+    status = MPU6500_ReadRegisters(hmpu, FIFO_COUNT_H, buffer, 2);
+    if(status != HAL_OK) return status;
+    *count = (uint16_t)(((buffer[0] & 0x1F) << 8) | buffer[1]);   // 13-bit count
+    return HAL_OK;
+}
+
+/**
+ * @brief Drain whole frames from the FIFO in one burst read
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param buffer Buffer for the raw frames, max_frames * frame size bytes
+ * @param max_frames Capacity of buffer in frames
+ * @param batch Pointer to store the number of frames read and resync events
+ * @return HAL_StatusTypeDef HAL_OK on success (also with 0 frames), error on failure
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Read(MPU6500_Handle *hmpu, uint8_t *buffer, uint16_t max_frames, MPU6500_FIFO_Batch *batch){
+    HAL_StatusTypeDef status;
+    uint16_t count, available, n;
+    uint8_t size = hmpu->fifo.frame_size;
+
+    memset(batch, 0, sizeof(*batch));
+    if(size == 0) return HAL_ERROR;
+    if(hmpu->fifo.resync) return MPU6500_FIFO_Resync(hmpu, batch);
+
+    status = MPU6500_FIFO_GetCount(hmpu, &count);
+    if(status != HAL_OK) return status;
+    batch->time_us = (hmpu->clock_us != NULL) ? hmpu->clock_us() : (uint64_t)HAL_GetTick() * 1000U;
+    // Once the FIFO overflowed it stays full, with the oldest bytes overwritten
+    // and no frame boundary at the read pointer. A count past the last whole
+    // frame means a frame was cut off.
+    if(count >= MPU6500_FIFO_SIZE || count > MPU6500_FIFO_SIZE - MPU6500_FIFO_SIZE % size){
+        hmpu->stats.fifo_overflows++;
+        return MPU6500_FIFO_Resync(hmpu, batch);
+    }
+
+    available = count / size;
+    n = (available > max_frames) ? max_frames : available;
+    if(n != 0){
+        // FIFO_R_W does not auto-increment, a burst read pops consecutive bytes.
+        // Not retried: a transfer that broke off has popped an unknown number of bytes.
+        status = hmpu->bus->read(hmpu->bus->ctx, hmpu->address, FIFO_R_W, buffer, (uint16_t)(n * size), hmpu->read_timeout);
+        if(status != HAL_OK){
+            MPU6500_CountError(hmpu, status);
+            hmpu->stats.fifo_overflows++;
+            hmpu->fifo.resync = 1;
+            return status;
+        }
+    }
+    hmpu->fifo.backlog = (uint16_t)(available - n);
+    hmpu->fifo.tick = HAL_GetTick();
+    batch->frames = n;
+    batch->backlog = hmpu->fifo.backlog;
+    return HAL_OK;
+}
+
+/* FIFO_EN bit of each channel, in frame order: accel X/Y/Z, temp, gyro X/Y/Z */
+static const uint8_t mpu6500_fifo_channel_bits[7] = { 0x08, 0x08, 0x08, 0x80, 0x40, 0x20, 0x10 };
+
+/* Words byte-swapped per decoder pass, bounds the stack use */
+#define MPU6500_DECODE_CHUNK    64
+
+/**
+ * @brief Convert big-endian register words to host int16
+ * @param src Big-endian words, any alignment
+ * @param dst Destination
+ * @param count Number of words
+ */
+static void MPU6500_SwapWords(const uint8_t *src, int16_t *dst, uint16_t count){
+    uint16_t i = 0;
+
+#if defined(__SSE2__)
+    for(; i + 8 <= count; i += 8){
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+    for(; i + 2 <= count; i += 2){
+        uint32_t w;
+        memcpy(&w, src + 2 * i, 4);     // Unaligned LDR
+        w = __REV16(w);                 // Swap the bytes of both halfwords
+        memcpy(dst + i, &w, 4);
+    }
+#endif
+    for(; i < count; i++){
+        dst[i] = (int16_t)((src[2 * i] << 8) | src[2 * i + 1]);
+    }
+}
+
+/**
+ * @brief Decode FIFO frames into raw and/or converted channel arrays
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param buffer Raw FIFO frames
+ * @param frames Number of frames
+ * @param raw Raw destinations (7 entries, NULL to skip), or NULL
+ * @param conv Converted destinations (7 entries, NULL to skip), or NULL
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if streaming is off
+ */
+static HAL_StatusTypeDef MPU6500_FIFO_DecodeFrames(MPU6500_Handle *hmpu, const uint8_t *buffer, uint16_t frames,
+                                                   int16_t *const *raw, float *const *conv){
+    int16_t words[MPU6500_DECODE_CHUNK];
+    int8_t layout[7];
+    float scale[7];
+    int16_t offset[7];
+    uint8_t n = 0, c;
+    uint16_t done, k, f, per_chunk;
+
+    if(hmpu->fifo.frame_size == 0) return HAL_ERROR;
+    for(c = 0; c < 7; c++){
+        layout[c] = (hmpu->fifo.channels & mpu6500_fifo_channel_bits[c]) ? (int8_t)n++ : -1;
+    }
+    for(c = 0; c < 3; c++){
+        scale[c] = hmpu->accel_scale;
+        offset[c] = hmpu->accel_offset[c];
+        scale[4 + c] = hmpu->gyro_scale;
+        offset[4 + c] = hmpu->gyro_offset[c];
+    }
+    scale[3] = 0.0f;        // Temperature is converted as in MPU6500_ConvertSample
+    offset[3] = 0;
+
+    per_chunk = MPU6500_DECODE_CHUNK / n;
+    for(done = 0; done < frames; done += k){
+        k = (uint16_t)(frames - done);
+        if(k > per_chunk) k = per_chunk;
+        MPU6500_SwapWords(buffer + (uint32_t)done * n * 2, words, (uint16_t)(k * n));
+
+        for(c = 0; c < 7; c++){
+            const int16_t *src;
+            if(layout[c] < 0) continue;
+            src = &words[layout[c]];
+            if(raw != NULL && raw[c] != NULL){
+                for(f = 0; f < k; f++) raw[c][done + f] = src[f * n];
+            }
+            if(conv == NULL || conv[c] == NULL) continue;
+            // Same arithmetic as MPU6500_ConvertSample, results are bit-identical
+            if(c == 3){
+                for(f = 0; f < k; f++) conv[c][done + f] = (float)src[f * n] / MPU6500_TEMP_SENS + MPU6500_TEMP_OFFSET;
+            } else {
+                for(f = 0; f < k; f++) conv[c][done + f] = (float)(int16_t)(src[f * n] - offset[c]) * scale[c];
+            }
+        }
+    }
+    return HAL_OK;
+}
+
+/**
+ * @brief Decode raw FIFO frames into per-channel int16 arrays
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param buffer Frames read by MPU6500_FIFO_Read
+ * @param frames Number of frames in buffer
+ * @param out Destination arrays
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if streaming is off
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Decode(MPU6500_Handle *hmpu, const uint8_t *buffer, uint16_t frames, const MPU6500_RawChannels *out){
+    int16_t *const dst[7] = { out->accel[0], out->accel[1], out->accel[2], out->temp,
+                              out->gyro[0], out->gyro[1], out->gyro[2] };
+    return MPU6500_FIFO_DecodeFrames(hmpu, buffer, frames, dst, NULL);
+}
+
+/**
+ * @brief Decode raw FIFO frames into per-channel arrays in physical units
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param buffer Frames read by MPU6500_FIFO_Read
+ * @param frames Number of frames in buffer
+ * @param out Destination arrays
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if streaming is off
+ */
+HAL_StatusTypeDef MPU6500_FIFO_DecodeFloat(MPU6500_Handle *hmpu, const uint8_t *buffer, uint16_t frames, const MPU6500_Channels *out){
+    float *const dst[7] = { out->accel[0], out->accel[1], out->accel[2], out->temp,
+                            out->gyro[0], out->gyro[1], out->gyro[2] };
+    return MPU6500_FIFO_DecodeFrames(hmpu, buffer, frames, NULL, dst);
+}
+
+/**
+ * @brief Convert a block of raw X/Y/Z triplets to float
+ * @param raw Interleaved raw triplets (X0 Y0 Z0 X1 ...)
+ * @param count Number of triplets
+ * @param offset Per-axis offsets subtracted before scaling (raw LSB)
+ * @param scale Output units per LSB
+ * @param out Interleaved destination, 3 * count floats
+ */
+void MPU6500_ConvertBatch(const int16_t *raw, uint32_t count, const int16_t offset[3], float scale, float *out){
+    uint32_t i = 0, n = count * 3;
+    const int16_t o0 = offset[0], o1 = offset[1], o2 = offset[2];
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // 24 values = 8 triplets = 3 vectors of 8 int16; the offset pattern
+    // repeats every 3 vectors, starting at X, Z and Y respectively
+    const int16_t pattern[24] = { o0, o1, o2, o0, o1, o2, o0, o1, o2, o0, o1, o2,
+                                  o0, o1, o2, o0, o1, o2, o0, o1, o2, o0, o1, o2 };
+#endif
+#if defined(__AVX2__)
+    const __m128i off0 = _mm_loadu_si128((const __m128i *)&pattern[0]);
+    const __m128i off1 = _mm_loadu_si128((const __m128i *)&pattern[8]);
+    const __m128i off2 = _mm_loadu_si128((const __m128i *)&pattern[16]);
+    const __m256 k = _mm256_set1_ps(scale);
+    for(; i + 24 <= n; i += 24){
+        __m128i a = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(raw + i)), off0);
+        __m128i b = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(raw + i + 8)), off1);
+        __m128i c = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(raw + i + 16)), off2);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a)), k));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b)), k));
+        _mm256_storeu_ps(out + i + 16, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(c)), k));
+    }
+#elif defined(__SSE2__)
+    const __m128i off[3] = { _mm_loadu_si128((const __m128i *)&pattern[0]),
+                             _mm_loadu_si128((const __m128i *)&pattern[8]),
+                             _mm_loadu_si128((const __m128i *)&pattern[16]) };
+    const __m128 k = _mm_set1_ps(scale);
+    for(; i + 24 <= n; i += 24){
+        uint8_t v;
+        for(v = 0; v < 3; v++){
+            __m128i w = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(raw + i + 8 * v)), off[v]);
+            // Sign-extend to 32 bits: duplicate each word, shift the copy down
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(w, w), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(w, w), 16);
+            _mm_storeu_ps(out + i + 8 * v, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+            _mm_storeu_ps(out + i + 8 * v + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+        }
+    }
+#endif
+    // Remaining triplets, and the whole block on Cortex-M: constants stay in registers
+    for(; i < n; i += 3){
+        out[i]     = (float)(int16_t)(raw[i] - o0) * scale;
+        out[i + 1] = (float)(int16_t)(raw[i + 1] - o1) * scale;
+        out[i + 2] = (float)(int16_t)(raw[i + 2] - o2) * scale;
+    }
+}
+
+/**
+ * @brief Convert logged raw accelerometer triplets to m/s²
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param raw Interleaved raw triplets
+ * @param count Number of triplets
+ * @param out Interleaved destination, 3 * count floats
+ */
+void MPU6500_ConvertAccelBatch(MPU6500_Handle *hmpu, const int16_t *raw, uint32_t count, float *out){
+    MPU6500_ConvertBatch(raw, count, hmpu->accel_offset, hmpu->accel_scale * MPU6500_GRAVITY, out);
+}
 
 /**
- * @brief Write a single byte to an MPU6500 register
- * @param reg Register address to write to
- * @param data Data byte to write
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @brief Convert logged raw gyroscope triplets to rad/s
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param raw Interleaved raw triplets
+ * @param count Number of triplets
+ * @param out Interleaved destination, 3 * count floats
  */
-static inline HAL_StatusTypeDef MPU6500_WriteRegister(uint8_t reg, uint8_t data){
-    return HAL_I2C_Mem_Write(&hi2c1, (MPU6500_ADDR << 1), reg, I2C_MEMADD_SIZE_8BIT, &data, 1, HAL_MAX_DELAY);
+void MPU6500_ConvertGyroBatch(MPU6500_Handle *hmpu, const int16_t *raw, uint32_t count, float *out){
+    MPU6500_ConvertBatch(raw, count, hmpu->gyro_offset, hmpu->gyro_scale * MPU6500_DEG_TO_RAD, out);
 }
 
 /**
- * @brief Read a single byte from an MPU6500 register
- * @param reg Register address to read from
- * @param data Pointer to store read data
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @brief Set the time source used to timestamp FIFO batches
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param clock_us Function returning a free running time in µs, NULL for HAL_GetTick
  */
-static inline HAL_StatusTypeDef MPU6500_ReadRegister(uint8_t reg, uint8_t *data){
-    return HAL_I2C_Mem_Read(&hi2c1, (MPU6500_ADDR << 1), reg, I2C_MEMADD_SIZE_8BIT, data, 1, HAL_MAX_DELAY);
+void MPU6500_SetClock(MPU6500_Handle *hmpu, uint64_t (*clock_us)(void)){
+    hmpu->clock_us = clock_us;
+    hmpu->ts.valid = 0;
 }
 
 /**
- * @brief Reset the MPU6500
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @brief Assign a sample time to every frame of a FIFO batch
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param batch Batch returned by MPU6500_FIFO_Read
+ * @param timestamps Array for batch->frames timestamps in µs
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if streaming is off
  */
-static inline HAL_StatusTypeDef MPU6500_Reset(void){
-    return MPU6500_WriteRegister(PWR_MGMT_1, 0x80); // DEVICE_RESET[7]
+HAL_StatusTypeDef MPU6500_FIFO_Timestamp(MPU6500_Handle *hmpu, const MPU6500_FIFO_Batch *batch, uint64_t *timestamps){
+    uint64_t period = hmpu->ts.period_q16;
+    int64_t bound, newest, error;
+    uint32_t queued = (uint32_t)batch->frames + batch->backlog;
+    uint16_t i;
+
+    if(hmpu->fifo.frame_size == 0) return HAL_ERROR;
+    if(batch->resync || queued == 0) return HAL_OK;
+
+    // The newest frame counted cannot have been sampled after the drain
+    bound = (int64_t)batch->time_us * 1000;
+    newest = hmpu->ts.next_ns + (int64_t)(((queued - 1) * period + hmpu->ts.next_frac) >> 16);
+    if(!hmpu->ts.valid){
+        hmpu->ts.next_ns += bound - newest;
+        hmpu->ts.valid = 1;
+        hmpu->ts.drift_ns = 0;
+        hmpu->ts.drift_span = 0;
+    } else {
+        // Too late: impossible, correct fully. Too early: may just be a late drain.
+        error = bound - newest;
+        error = (error < 0) ? error : (error >> MPU6500_TS_SMOOTH_SHIFT);
+        hmpu->ts.next_ns += error;
+
+        // Phase corrections that do not average out come from a period error
+        hmpu->ts.drift_ns += error;
+        if(hmpu->ts.drift_span >= MPU6500_DRIFT_WINDOW){
+            int64_t nominal = (int64_t)hmpu->ts.nominal_ns << 16;
+            int64_t limit = nominal / 1000000 * MPU6500_DRIFT_LIMIT_PPM;
+            int64_t updated = (int64_t)period + hmpu->ts.drift_ns * 65536 / (int64_t)hmpu->ts.drift_span / 2;
+            if(updated > nominal + limit) updated = nominal + limit;
+            if(updated < nominal - limit) updated = nominal - limit;
+            hmpu->ts.period_q16 = (uint64_t)updated;
+            hmpu->ts.drift_ns = 0;
+            hmpu->ts.drift_span = 0;
+        }
+    }
+
+    for(i = 0; i < batch->frames; i++){
+        timestamps[i] = (uint64_t)((hmpu->ts.next_ns + (int64_t)((i * period + hmpu->ts.next_frac) >> 16)) / 1000);
+    }
+    period = batch->frames * period + hmpu->ts.next_frac;
+    hmpu->ts.next_ns += (int64_t)(period >> 16);
+    hmpu->ts.next_frac = (uint16_t)period;
+    hmpu->ts.drift_span += batch->frames;
+    return HAL_OK;
 }
 
 /**
- * @brief Configure the clock source of the MPU6500
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @brief Get the measured sample period
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return float Time between two samples in seconds, for integration and resampling
  */
-static inline HAL_StatusTypeDef MPU6500_ConfigureClock(void){
-    return MPU6500_WriteRegister(PWR_MGMT_1, 0x01); // SLEEP[6] | CLKSEL[2:0]
+float MPU6500_GetSamplePeriod(MPU6500_Handle *hmpu){
+    if(hmpu->ts.period_q16 == 0) return (float)MPU6500_SamplePeriodNs(hmpu) * 1e-9f;
+    return (float)hmpu->ts.period_q16 * (1e-9f / 65536.0f);
 }
 
 /**
- * @brief Configure the accelerometer
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Configuration sequence:
- *       1. Configure accelerometer full scale range
- *       2. Configure accelerometer low pass filter
+ * @brief Get the sensor clock drift relative to the MCU time source
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return int32_t Deviation of the measured from the nominal period in ppm
+ *         (positive: the sensor runs slow)
  */
-static inline HAL_StatusTypeDef MPU6500_ConfigureAccel(void){
-    HAL_StatusTypeDef status;
-    status = MPU6500_WriteRegister(ACCEL_CONFIG, MPU6500_DEFAULT_ACCEL_CONFIG); // ACCEL_FS_SEL[4:3] = 11 (±16g), bits [2:0] reserved (0)
-    if(status != HAL_OK) return status;
-    status = MPU6500_WriteRegister(ACCEL_CONFIG_2, 0x04); // ACCEL_DLPF_CFG[2:0] = 100 (20Hz, 1kHz)
-    if(status != HAL_OK) return status;
-    return HAL_OK;
+int32_t MPU6500_GetClockDrift(MPU6500_Handle *hmpu){
+    int64_t nominal = (int64_t)hmpu->ts.nominal_ns << 16;
+    if(nominal == 0) return 0;
+    return (int32_t)(((int64_t)hmpu->ts.period_q16 - nominal) * 1000000 / nominal);
 }
 
 /**
- * @brief Configure the gyroscope
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Configuration sequence:
- *       1. Configure gyroscope full scale range
- *       2. Configure gyroscope low pass filter
+ * @brief Get the data rate the FIFO produces
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return uint32_t Bytes per second the drains must sustain, 0 if streaming is off
  */
-static inline HAL_StatusTypeDef MPU6500_ConfigureGyro(void){
-    HAL_StatusTypeDef status;
-    status = MPU6500_WriteRegister(GYRO_CONFIG, MPU6500_DEFAULT_GYRO_CONFIG); // GYRO_FS_SEL[1:0] = 11 | FCHOICE_B[1:0] = 00 || Full scale range = ±2000dps
-    if(status != HAL_OK) return status;
-    status = MPU6500_WriteRegister(CONFIG, 0x04); // DLPF_CFG[2:0] = 100 || Gyroscope low pass filter Bandwidth = 20Hz | Data Rate = 1kHz
-    if(status != HAL_OK) return status;
-    return HAL_OK;  
-} 
+uint32_t MPU6500_FIFO_GetDataRate(MPU6500_Handle *hmpu){
+    return (uint32_t)(((uint64_t)hmpu->fifo.frame_size * 1000000000U) / MPU6500_SamplePeriodNs(hmpu));
+}
 
 /**
- * @brief Disable the gyroscope of the MPU6500
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @brief Get the size of one FIFO frame
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return uint8_t Bytes per frame, 0 if streaming is off
  */
-static inline HAL_StatusTypeDef MPU6500_DisableGyro(void){
-    return MPU6500_WriteRegister(PWR_MGMT_2, 0x07); // DISABLE_XG[2]|DISABLE_YG[1]|DISABLE_ZG[0]
+uint8_t MPU6500_FIFO_GetFrameSize(MPU6500_Handle *hmpu){
+    return hmpu->fifo.frame_size;
 }
 
 /**
- * @brief Enable the temperature sensor of the MPU6500
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @brief Rescale raw calibration offsets to a new sensitivity
+ * @param offset Offsets to rescale in place (raw LSB)
+ * @param from Sensitivity the offsets were taken at
+ * @param to New sensitivity
  */
-static inline HAL_StatusTypeDef MPU6500_EnableTemperatureSensor(void){
-    HAL_StatusTypeDef status;
-    uint8_t regData;
-    // Read current PWR_MGMT_1 register
-    status = MPU6500_ReadRegister(PWR_MGMT_1, &regData);
-    if(status != HAL_OK) return status;
-    // Clear TEMP_DIS bit (bit 4)
-    regData &= ~(1 << 4);
-    // Write back to PWR_MGMT_1
-    return MPU6500_WriteRegister(PWR_MGMT_1, regData);
+static void MPU6500_RescaleOffsets(int16_t offset[3], float from, float to){
+    uint8_t i;
+    float ratio = to / from;
+    for(i = 0; i < 3; i++){
+        float value = (float)offset[i] * ratio + (((float)offset[i] < 0.0f) ? -0.5f : 0.5f);
+        if(value > 32767.0f) value = 32767.0f;
+        if(value < -32768.0f) value = -32768.0f;
+        offset[i] = (int16_t)value;
+    }
 }
 
 /**
- * @brief Disable the temperature sensor of the MPU6500
+ * @brief Switch the accelerometer and gyroscope full scale ranges
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param accel_fs MPU6500_ACCEL_FS_xxx
+ * @param gyro_fs MPU6500_GYRO_FS_xxx
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  */
-static inline HAL_StatusTypeDef MPU6500_DisableTemperatureSensor(void){
+HAL_StatusTypeDef MPU6500_SetFullScale(MPU6500_Handle *hmpu, uint8_t accel_fs, uint8_t gyro_fs){
     HAL_StatusTypeDef status;
-    uint8_t regData;
-    // Read current PWR_MGMT_1 register
-    status = MPU6500_ReadRegister(PWR_MGMT_1, &regData);
+    uint8_t a, g;
+
+    if((accel_fs & ~0x18) || (gyro_fs & ~0x18)) return HAL_ERROR;
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_GYRO_CONFIG, 0x18, gyro_fs);     // GYRO_FS_SEL[4:3], FCHOICE_B kept
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_ACCEL_CONFIG, 0x18, accel_fs);   // ACCEL_FS_SEL[4:3]
+    status = MPU6500_CommitConfig(hmpu);
     if(status != HAL_OK) return status;
-    // Set TEMP_DIS bit (bit 4)
-    regData |= (1 << 4);
-    // Write back to PWR_MGMT_1
-    return MPU6500_WriteRegister(PWR_MGMT_1, regData);
-}   
+
+    // Frames queued so far carry no range tag and would be decoded with the
+    // new scale: drop them on the next drain and report them as lost
+    if(hmpu->fifo.frame_size != 0 && (accel_fs != hmpu->accel_fs || gyro_fs != hmpu->gyro_fs)){
+        hmpu->fifo.resync = 1;
+    }
+
+    // Latched data may still be at the old range until a new sample is taken
+    hmpu->autorange.prev_accel_fs = hmpu->accel_fs;
+    hmpu->autorange.prev_gyro_fs = hmpu->gyro_fs;
+    memcpy(hmpu->autorange.prev_accel_offset, hmpu->accel_offset, sizeof(hmpu->accel_offset));
+    memcpy(hmpu->autorange.prev_gyro_offset, hmpu->gyro_offset, sizeof(hmpu->gyro_offset));
+
+    a = accel_fs >> 3;
+    g = gyro_fs >> 3;
+    MPU6500_RescaleOffsets(hmpu->accel_offset, hmpu->accel_sens, mpu6500_accel_sens[a]);
+    MPU6500_RescaleOffsets(hmpu->gyro_offset, hmpu->gyro_sens, mpu6500_gyro_sens[g]);
+    hmpu->accel_fs = accel_fs;
+    hmpu->gyro_fs = gyro_fs;
+    hmpu->accel_sens = mpu6500_accel_sens[a];
+    hmpu->gyro_sens = mpu6500_gyro_sens[g];
+    hmpu->accel_scale = mpu6500_accel_scale[a];
+    hmpu->gyro_scale = mpu6500_gyro_scale[g];
+    hmpu->autorange.accel_target = accel_fs;
+    hmpu->autorange.gyro_target = gyro_fs;
+    hmpu->autorange.accel_quiet = 0;
+    hmpu->autorange.gyro_quiet = 0;
+    hmpu->autorange.settle = MPU6500_AUTORANGE_SETTLE;
+    return HAL_OK;
+}
 
 /**
- * @brief Configure the interrupt pin
+ * @brief Enable automatic full scale switching
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sensors MPU6500_AUTORANGE_xxx, MPU6500_AUTORANGE_OFF to disable
+ */
+void MPU6500_SetAutoRange(MPU6500_Handle *hmpu, uint8_t sensors){
+    hmpu->autorange.sensors = sensors & MPU6500_AUTORANGE_ALL;
+    hmpu->autorange.accel_target = hmpu->accel_fs;
+    hmpu->autorange.gyro_target = hmpu->gyro_fs;
+    hmpu->autorange.accel_quiet = 0;
+    hmpu->autorange.gyro_quiet = 0;
+}
+
+/**
+ * @brief Select the low pass filters and the output data rate
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param gyro_dlpf MPU6500_GYRO_DLPF_xxx
+ * @param accel_dlpf MPU6500_ACCEL_DLPF_xxx
+ * @param smplrt_div Sample rate divider: ODR = 1 kHz / (1 + smplrt_div)
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- */ 
-static inline HAL_StatusTypeDef MPU6500_ConfigureInterrupts(void){
+ */
+HAL_StatusTypeDef MPU6500_SetDataRate(MPU6500_Handle *hmpu, uint8_t gyro_dlpf, uint8_t accel_dlpf, uint8_t smplrt_div){
     HAL_StatusTypeDef status;
-    status = MPU6500_WriteRegister(INT_PIN_CFG, 0xB0); // ACTL[7] | OPEN[6] | LATCH_INT_EN[5] | INT_ANYRD_2CLEAR[4]
+
+    if(gyro_dlpf > 7 || accel_dlpf > 7) return HAL_ERROR;
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_SMPLRT_DIV, 0xFF, smplrt_div);
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_CONFIG, 0x07, gyro_dlpf);                 // DLPF_CFG[2:0]
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_ACCEL_CONFIG_2, 0x07, accel_dlpf);        // A_DLPF_CFG[2:0]
+    status = MPU6500_CommitConfig(hmpu);
     if(status != HAL_OK) return status;
+
+    MPU6500_UpdateSamplePeriod(hmpu);
     return HAL_OK;
 }
 
 /**
- * @brief Initialize the MPU6500 accelerometer
- * @return HAL_StatusTypeDef HAL_OK on success, error code on failure
- * @note Configuration sequence:
- *       1. Reset device
- *       2. Wake up and configure clock
- *       3. Configure accelerometer (±16g, 20Hz bandwidth)
- *       4. Configure gyroscope (±2000dps, 20Hz bandwidth)
- *       5. Enable temperature sensor
- *       6. Configure interrupt pin
+ * @brief Bypass the low pass filters for raw high-bandwidth data
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param gyro_bypass MPU6500_GYRO_BYPASS_xxx
+ * @param accel_bypass MPU6500_ACCEL_BYPASS_xxx
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  */
-HAL_StatusTypeDef MPU6500_Init(void){
+HAL_StatusTypeDef MPU6500_SetHighRateMode(MPU6500_Handle *hmpu, uint8_t gyro_bypass, uint8_t accel_bypass){
     HAL_StatusTypeDef status;
-    // 1. Reset device
-    status = MPU6500_Reset();
-    if (status != HAL_OK) return status;
-    HAL_Delay(100); // Wait for reset to complete
-    // 2. Wake up device and select clock source
-    status = MPU6500_ConfigureClock();
-    if(status != HAL_OK) return status;
-    // 3. Configure Accelerometer
-    status = MPU6500_ConfigureAccel();
-    if(status != HAL_OK) return status;
-    // 4. Configure Gyroscope
-    status = MPU6500_ConfigureGyro();
-    if(status != HAL_OK) return status;
-    // 5. Enable temperature sensor
-    status = MPU6500_EnableTemperatureSensor();
-    if(status != HAL_OK) return status; 
-    // 6. Configure INT Pin (but don't enable interrupts yet)
-    status = MPU6500_ConfigureInterrupts();
+
+    if(gyro_bypass > MPU6500_GYRO_BYPASS_3600HZ) return HAL_ERROR;
+    if(accel_bypass != MPU6500_ACCEL_BYPASS_OFF && accel_bypass != MPU6500_ACCEL_BYPASS_1130HZ) return HAL_ERROR;
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_GYRO_CONFIG, 0x03, gyro_bypass);         // FCHOICE_B[1:0]
+    MPU6500_StageRegister(hmpu, MPU6500_SHADOW_ACCEL_CONFIG_2, 0x08, accel_bypass);     // ACCEL_FCHOICE_B[3]
+    status = MPU6500_CommitConfig(hmpu);
     if(status != HAL_OK) return status;
+
+    MPU6500_UpdateSamplePeriod(hmpu);
     return HAL_OK;
 }
 
 /**
- * @brief Enable data ready interrupts from the MPU6500
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Enables RAW_RDY_EN bit in INT_ENABLE register
+ * @brief Get the nominal output data rate of the current configuration
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return float Samples per second written to the data registers and the FIFO
  */
-HAL_StatusTypeDef MPU6500_EnableDataReadyInterrupts(void){
-    return MPU6500_WriteRegister(INT_ENABLE, 0x01); // RAW_RDY_EN[0]
+float MPU6500_GetOutputDataRate(MPU6500_Handle *hmpu){
+    return 1e9f / (float)MPU6500_SamplePeriodNs(hmpu);
 }
 
 /**
- * @brief Disable data ready interrupts from the MPU6500
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Disables RAW_RDY_EN bit in INT_ENABLE register
+ * @brief Look up bandwidth, group delay and sample rate of a gyro filter setting
+ * @param dlpf MPU6500_GYRO_DLPF_xxx
+ * @return const MPU6500_FilterInfo* Filter characteristics, NULL if dlpf is invalid
  */
-HAL_StatusTypeDef MPU6500_DisableDataReadyInterrupts(void){
-    return MPU6500_WriteRegister(INT_ENABLE, 0x00); // RAW_RDY_EN[0]
+const MPU6500_FilterInfo *MPU6500_GetGyroFilterInfo(uint8_t dlpf){
+    return (dlpf < 8) ? &mpu6500_gyro_filters[dlpf] : NULL;
 }
 
 /**
- * @brief Read the WHO_AM_I register of the MPU6500
- * @param whoami Pointer to store the value read from WHO_AM_I register
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @brief Look up bandwidth, group delay and sample rate of an accel filter setting
+ * @param dlpf MPU6500_ACCEL_DLPF_xxx, or MPU6500_ACCEL_BYPASS_1130HZ for the 4 kHz bypass
+ * @return const MPU6500_FilterInfo* Filter characteristics, NULL if dlpf is invalid
  */
-HAL_StatusTypeDef MPU6500_ReadWhoAmI(uint8_t *whoami){  
-    return MPU6500_ReadRegister(WHO_AM_I, whoami);
+const MPU6500_FilterInfo *MPU6500_GetAccelFilterInfo(uint8_t dlpf){
+    if(dlpf == MPU6500_ACCEL_BYPASS_1130HZ) return &mpu6500_accel_bypass;
+    return (dlpf < 8) ? &mpu6500_accel_filters[dlpf] : NULL;
 }
 
-HAL_StatusTypeDef MPU6500_ReadRawAccel(int16_t *x, int16_t *y, int16_t *z){
-    HAL_StatusTypeDef status;
-    uint8_t buffer[6];  // 6 bytes for data
-    // Read all 6 bytes starting from ACCEL_XOUT_H
-    status = HAL_I2C_Mem_Read(&hi2c1, (MPU6500_ADDR << 1), ACCEL_XOUT_H, I2C_MEMADD_SIZE_8BIT, buffer, 6, HAL_MAX_DELAY);
-    if(status != HAL_OK) return status;
-    // Combine bytes into 16-bit values (high byte first, then low byte)
-    *x = (int16_t)((buffer[0] << 8) | buffer[1]);
-    *y = (int16_t)((buffer[2] << 8) | buffer[3]);
-    *z = (int16_t)((buffer[4] << 8) | buffer[5]);
-    return HAL_OK;
-}   
-
 /**
- * @brief Read gyroscope data from MPU6500
- * @param x Pointer to store X-axis gyroscope data
- * @param y Pointer to store Y-axis gyroscope data
- * @param z Pointer to store Z-axis gyroscope data
+ * @brief Put the MPU6500 into sleep mode to save power
+ * @param hmpu Pointer to the MPU6500 handle
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Reads 6 bytes starting from GYRO_XOUT_H register
- *       Data is in 16-bit format, high byte first
+ * @note Sets SLEEP bit (bit 6) in PWR_MGMT_1 register
  */
-HAL_StatusTypeDef MPU6500_ReadRawGyro(int16_t *x, int16_t *y, int16_t *z){
-    HAL_StatusTypeDef status;
-    uint8_t buffer[6];  // 6 bytes for data
-    // Read all 6 bytes starting from GYRO_XOUT_H
-    status = HAL_I2C_Mem_Read(&hi2c1, (MPU6500_ADDR << 1), GYRO_XOUT_H, I2C_MEMADD_SIZE_8BIT, buffer, 6, HAL_MAX_DELAY);
-    if(status != HAL_OK) return status;
-    // Combine bytes into 16-bit values (high byte first, then low byte)
-    *x = (int16_t)((buffer[0] << 8) | buffer[1]);
-    *y = (int16_t)((buffer[2] << 8) | buffer[3]);
-    *z = (int16_t)((buffer[4] << 8) | buffer[5]);
-    return HAL_OK;
-}       
+HAL_StatusTypeDef MPU6500_Sleep(MPU6500_Handle *hmpu){
+    // Set SLEEP bit (bit 6)
+    return MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_PWR_MGMT_1, 0, (1 << 6));
+}
 
 /**
- * @brief Read accelerometer data from MPU6500
- * @param x Pointer to store X-axis acceleration in g
- * @param y Pointer to store Y-axis acceleration in g
- * @param z Pointer to store Z-axis acceleration in g
+ * @brief Wake up the MPU6500 from sleep mode
+ * @param hmpu Pointer to the MPU6500 handle
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Reads 6 bytes starting from ACCEL_XOUT_H register
- *       Converts raw data to physical units using configured sensitivity
+ * @note Clears SLEEP bit (bit 6) in PWR_MGMT_1 register
  */
-HAL_StatusTypeDef MPU6500_ReadAccel(float *x, float *y, float *z){
-    HAL_StatusTypeDef status;
-    uint8_t buffer[6];  // 6 bytes for data
-    int16_t raw_x, raw_y, raw_z;
-    
-    // Read all 6 bytes starting from ACCEL_XOUT_H
-    status = HAL_I2C_Mem_Read(&hi2c1, (MPU6500_ADDR << 1), ACCEL_XOUT_H, I2C_MEMADD_SIZE_8BIT, buffer, 6, HAL_MAX_DELAY);
-    if(status != HAL_OK) return status;
-    
-    // Combine bytes into 16-bit values (high byte first, then low byte)
-    raw_x = (int16_t)((buffer[0] << 8) | buffer[1]) - accel_offset[0];
-    raw_y = (int16_t)((buffer[2] << 8) | buffer[3]) - accel_offset[1];
-    raw_z = (int16_t)((buffer[4] << 8) | buffer[5]) - accel_offset[2];
-    
-    // Convert to physical units (g)
-    *x = (float)raw_x / MPU6500_ACCEL_SENS;
-    *y = (float)raw_y / MPU6500_ACCEL_SENS;
-    *z = (float)raw_z / MPU6500_ACCEL_SENS;
-    
-    return HAL_OK;
+HAL_StatusTypeDef MPU6500_WakeUp(MPU6500_Handle *hmpu){
+    // Clear SLEEP bit (bit 6)
+    return MPU6500_UpdateRegister(hmpu, MPU6500_SHADOW_PWR_MGMT_1, (1 << 6), 0);
 }
 
+
 /**
- * @brief Read gyroscope data from MPU6500
- * @param x Pointer to store X-axis gyroscope data in degrees per second
- * @param y Pointer to store Y-axis gyroscope data in degrees per second
- * @param z Pointer to store Z-axis gyroscope data in degrees per second
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Reads 6 bytes starting from GYRO_XOUT_H register
- *       Converts raw data to physical units using configured sensitivity
+ * @brief Round and saturate a value to int16
+ * @param value Value to convert
+ * @return int16_t Nearest int16, clamped to the int16 range
  */
-HAL_StatusTypeDef MPU6500_ReadGyro(float *x, float *y, float *z){
-    HAL_StatusTypeDef status;
-    uint8_t buffer[6];  // 6 bytes for data
-    int16_t raw_x, raw_y, raw_z;
-    
-    // Read all 6 bytes starting from GYRO_XOUT_H
-    status = HAL_I2C_Mem_Read(&hi2c1, (MPU6500_ADDR << 1), GYRO_XOUT_H, I2C_MEMADD_SIZE_8BIT, buffer, 6, HAL_MAX_DELAY);
-    if(status != HAL_OK) return status;
-    
-    // Combine bytes into 16-bit values (high byte first, then low byte)
-    raw_x = (int16_t)((buffer[0] << 8) | buffer[1]) - gyro_offset[0];
-    raw_y = (int16_t)((buffer[2] << 8) | buffer[3]) - gyro_offset[1];
-    raw_z = (int16_t)((buffer[4] << 8) | buffer[5]) - gyro_offset[2];
-    
-    // Convert to physical units (degrees per second)
-    *x = (float)raw_x / MPU6500_GYRO_SENS;
-    *y = (float)raw_y / MPU6500_GYRO_SENS;
-    *z = (float)raw_z / MPU6500_GYRO_SENS;
-    
-    return HAL_OK;
+static int16_t MPU6500_RoundInt16(float value){
+    value += (value < 0.0f) ? -0.5f : 0.5f;
+    if(value > 32767.0f) return 32767;
+    if(value < -32768.0f) return -32768;
+    return (int16_t)value;
 }
 
 /**
- * @brief Read temperature data from MPU6500
- * @param[out] temp Pointer to store the raw temperature value (signed 16-bit)
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Reads 2 bytes from TEMP_OUT_H and TEMP_OUT_L.
- *       The value is in 16-bit signed format (big endian).
- *       Conversion to Celsius: Temp(°C) = temp / 333.87 + 21
+ * @brief Integer sums of the six calibration channels
  */
-HAL_StatusTypeDef MPU6500_ReadTemp(int16_t *temp){
-    HAL_StatusTypeDef status;
-    uint8_t buffer[2];
+typedef struct {
+    uint32_t n;             // Samples
+    int64_t sum[6];         // Sums of the samples minus the reference: accel X/Y/Z (Z minus 1 g), gyro X/Y/Z
+    int64_t sumsq[6];       // Sums of their squares (LSB²)
+} MPU6500_CalibSums;
 
-    // Read 2 bytes starting from TEMP_OUT_H
-    status = HAL_I2C_Mem_Read(&hi2c1, (MPU6500_ADDR << 1), TEMP_OUT_H, I2C_MEMADD_SIZE_8BIT, buffer, 2, HAL_MAX_DELAY);
-    if (status != HAL_OK) return status;
+/**
+ * @brief Window bookkeeping shared by the calibration routines
+ */
+typedef struct {
+    MPU6500_CalibSums window;   // Window being collected
+    MPU6500_CalibSums total;    // All accepted windows
+    int32_t ref[6];             // First sample, subtracted so the sums stay small
+    float limit[6];             // Largest accepted window variance (LSB²), 0 = unchecked
+    uint32_t windows;           // Windows accepted
+    uint32_t rejected;          // Windows rejected
+} MPU6500_CalibState;
 
-    // Combine bytes into signed 16-bit integer
-    *temp = (int16_t)((buffer[0] << 8) | buffer[1]);
+/**
+ * @brief Prepare the calibration statistics
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param st Calibration state
+ * @param accel_noise_g Largest accepted accel standard deviation (g), 0 = unchecked
+ * @param gyro_noise_dps Largest accepted gyro standard deviation (°/s), 0 = unchecked
+ */
+static void MPU6500_CalibBegin(MPU6500_Handle *hmpu, MPU6500_CalibState *st, float accel_noise_g, float gyro_noise_dps){
+    float a = accel_noise_g * hmpu->accel_sens, g = gyro_noise_dps * hmpu->gyro_sens;
+    uint8_t i;
 
-    return HAL_OK;
+    memset(st, 0, sizeof(*st));
+    for(i = 0; i < 3; i++){
+        st->limit[i] = (accel_noise_g > 0.0f) ? a * a : 0.0f;
+        st->limit[3 + i] = (gyro_noise_dps > 0.0f) ? g * g : 0.0f;
+    }
 }
 
 /**
- * @brief Put the MPU6500 into sleep mode to save power
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Sets SLEEP bit (bit 6) in PWR_MGMT_1 register
+ * @brief Add one sample to the current calibration window
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param st Calibration state
+ * @param raw Raw accel X/Y/Z and gyro X/Y/Z
+ * @note Integer only: two 64-bit adds and a 32x32->64 multiply per channel.
  */
-HAL_StatusTypeDef MPU6500_Sleep(void){
-    HAL_StatusTypeDef status;
-    uint8_t regData;
-    // Read current PWR_MGMT_1 register
-    status = MPU6500_ReadRegister(PWR_MGMT_1, &regData);
-    if(status != HAL_OK) return status;
-    // Set SLEEP bit (bit 6)
-    regData |= (1 << 6);
-    // Write back to PWR_MGMT_1
-    return MPU6500_WriteRegister(PWR_MGMT_1, regData);
+static void MPU6500_CalibAdd(MPU6500_Handle *hmpu, MPU6500_CalibState *st, const int16_t raw[6]){
+    MPU6500_CalibSums *w = &st->window;
+    int32_t value;
+    uint8_t i;
+
+    for(i = 0; i < 6; i++){
+        value = raw[i];
+        if(i == 2) value -= (int16_t)hmpu->accel_sens;  // Z axis reads +1 g at rest
+        if(st->total.n == 0 && w->n == 0) st->ref[i] = value;
+        value -= st->ref[i];
+        w->sum[i] += value;
+        w->sumsq[i] += (int64_t)value * value;
+    }
+    w->n++;
 }
 
 /**
- * @brief Wake up the MPU6500 from sleep mode
- * @return HAL_StatusTypeDef HAL_OK on success, error on failure
- * @note Clears SLEEP bit (bit 6) in PWR_MGMT_1 register
+ * @brief Close the current window, merging it into the totals if it was quiet
+ * @param st Calibration state
+ * @return uint8_t 1 if the window was accepted, 0 if it was rejected
  */
-HAL_StatusTypeDef MPU6500_WakeUp(void){
-    HAL_StatusTypeDef status;
-    uint8_t regData;
-    // Read current PWR_MGMT_1 register
-    status = MPU6500_ReadRegister(PWR_MGMT_1, &regData);
-    if(status != HAL_OK) return status;
-    // Clear SLEEP bit (bit 6)
-    regData &= ~(1 << 6);
-    // Write back to PWR_MGMT_1
-    return MPU6500_WriteRegister(PWR_MGMT_1, regData);
+static uint8_t MPU6500_CalibEndWindow(MPU6500_CalibState *st){
+    MPU6500_CalibSums *w = &st->window, *t = &st->total;
+    int64_t nm2;
+    uint8_t i;
+
+    if(w->n == 0) return 1;
+    for(i = 0; w->n > 1 && i < 6; i++){
+        // n * m2 = n * sumsq - sum², exact in 64 bits for windows of up to 32768 samples.
+        // Sample variance m2 / (n - 1) above the limit: the sensor moved
+        nm2 = (int64_t)w->n * w->sumsq[i] - w->sum[i] * w->sum[i];
+        if(st->limit[i] > 0.0f && (float)nm2 > st->limit[i] * (float)w->n * (float)(w->n - 1)){
+            st->rejected++;
+            memset(w, 0, sizeof(*w));
+            return 0;
+        }
+    }
+    for(i = 0; i < 6; i++){
+        t->sum[i] += w->sum[i];
+        t->sumsq[i] += w->sumsq[i];
+    }
+    t->n += w->n;
+    st->windows++;
+    memset(w, 0, sizeof(*w));
+    return 1;
+}
+
+/**
+ * @brief Mean of one channel over the accepted windows
+ * @param st Calibration state
+ * @param i Channel: accel X/Y/Z, gyro X/Y/Z
+ * @return float Mean in raw LSB, 0 before the first accepted window
+ */
+static float MPU6500_CalibMean(const MPU6500_CalibState *st, uint8_t i){
+    if(st->total.n == 0) return 0.0f;
+    return (float)st->ref[i] + (float)st->total.sum[i] / (float)st->total.n;
 }
 
+/**
+ * @brief Mean of one channel as an offset, rounded to the nearest LSB
+ * @param st Calibration state, at least one accepted sample
+ * @param i Channel: accel X/Y/Z, gyro X/Y/Z
+ * @return int16_t Offset, clamped to the int16 range
+ */
+static int16_t MPU6500_CalibOffset(const MPU6500_CalibState *st, uint8_t i){
+    int64_t n = st->total.n, sum = st->total.sum[i];
+    int64_t mean = st->ref[i] + ((sum >= 0) ? sum + n / 2 : sum - n / 2) / n;
+
+    if(mean > 32767) return 32767;
+    if(mean < -32768) return -32768;
+    return (int16_t)mean;
+}
+
+/**
+ * @brief Store the accepted means as offsets and fill in the result
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param st Calibration state
+ * @param commit 1 to write the offsets to the handle
+ * @param result Pointer to store the quality figures, or NULL
+ */
+static void MPU6500_CalibFinish(MPU6500_Handle *hmpu, const MPU6500_CalibState *st, uint8_t commit, MPU6500_CalibResult *result){
+    int64_t n = st->total.n, q, r, m2, accel_m2 = 0, gyro_m2 = 0;
+    uint8_t i;
+
+    if(commit && st->total.n != 0){
+        for(i = 0; i < 3; i++){
+            hmpu->accel_offset[i] = MPU6500_CalibOffset(st, i);
+            hmpu->gyro_offset[i] = MPU6500_CalibOffset(st, 3 + i);
+        }
+    }
+    if(result == NULL) return;
+    for(i = 0; n > 1 && i < 6; i++){
+        // m2 = (n * sumsq - sum²) / n as in MPU6500_CalibEndWindow, but n * sumsq
+        // overflows past 32768 samples. With sum = q * n + r:
+        // m2 = sumsq - q * (q * n + 2 * r) - r² / n, integer to within 1 LSB²
+        q = st->total.sum[i] / n;
+        r = st->total.sum[i] % n;
+        m2 = st->total.sumsq[i] - q * (q * n + 2 * r) - r * r / n;
+        if(i < 3 && m2 > accel_m2) accel_m2 = m2;
+        if(i >= 3 && m2 > gyro_m2) gyro_m2 = m2;
+    }
+    result->samples = st->total.n;
+    result->converged = 0;
+    result->windows = st->windows;
+    result->rejected = st->rejected;
+    result->accel_noise_g = (n > 1) ? sqrtf((float)accel_m2 / (float)(n - 1)) * hmpu->accel_scale : 0.0f;
+    result->gyro_noise_dps = (n > 1) ? sqrtf((float)gyro_m2 / (float)(n - 1)) * hmpu->gyro_scale : 0.0f;
+    result->quality = (uint8_t)((st->windows + st->rejected) ? (100U * st->windows) / (st->windows + st->rejected) : 0U);
+}
 
-HAL_StatusTypeDef MPU6500_InitOffsetCalibration(uint32_t samples) {
+HAL_StatusTypeDef MPU6500_InitOffsetCalibration(MPU6500_Handle *hmpu, uint32_t samples) {
+    return MPU6500_InitOffsetCalibrationEx(hmpu, samples, NULL);
+}
+
+/**
+ * @brief Calibrate the offsets from blocking reads and report the quality figures
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param samples Number of samples to collect for calibration
+ * @param result Pointer to store the sample count and quality figures, or NULL
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if the sensor kept
+ *         moving, error on failure
+ */
+HAL_StatusTypeDef MPU6500_InitOffsetCalibrationEx(MPU6500_Handle *hmpu, uint32_t samples, MPU6500_CalibResult *result) {
     HAL_StatusTypeDef status = HAL_OK;
-    int32_t accel_sum[3] = {0};
-    int32_t gyro_sum[3] = {0};
-    uint32_t i;
+    MPU6500_CalibState st;
     
     // 验证参数有效性
     if (samples == 0) {
@@ -463,71 +2635,200 @@ HAL_StatusTypeDef MPU6500_InitOffsetCalibration(uint32_t samples) {
     }
     
     // 确保传感器已初始化并处于活跃状态
-    status = MPU6500_WakeUp();
+    status = MPU6500_WakeUp(hmpu);
     if (status != HAL_OK) {
         return status;
     }
     
-    // 收集样本数据
-    for (i = 0; i < samples; i++) {
-        int16_t raw_accel[3];
-        int16_t raw_gyro[3];
+    // 收集样本数据，按窗口检查方差，晃动的窗口被丢弃并重新采集
+    MPU6500_CalibBegin(hmpu, &st, MPU6500_CALIB_ACCEL_NOISE_G, MPU6500_CALIB_GYRO_NOISE_DPS);
+    while (st.total.n < samples) {
+        int16_t raw[6];
         
         // 读取原始加速度计数据
-        status = MPU6500_ReadRawAccel(&raw_accel[0], &raw_accel[1], &raw_accel[2]);
+        status = MPU6500_ReadRawAccel(hmpu, &raw[0], &raw[1], &raw[2]);
         if (status != HAL_OK) {
-            return status;
+            break;
         }
         
         // 读取原始陀螺仪数据
-        status = MPU6500_ReadRawGyro(&raw_gyro[0], &raw_gyro[1], &raw_gyro[2]);
+        status = MPU6500_ReadRawGyro(hmpu, &raw[3], &raw[4], &raw[5]);
         if (status != HAL_OK) {
-            return status;
+            break;
         }
         
-        // 累加数据（注意：对于Z轴加速度，我们期望它接近1g，所以需要减去1g的原始值）
-        accel_sum[0] += raw_accel[0];
-        accel_sum[1] += raw_accel[1];
-        accel_sum[2] += (raw_accel[2] - (int16_t)(1.0f * MPU6500_ACCEL_SENS));
-        
-        // 累加陀螺仪数据
-        gyro_sum[0] += raw_gyro[0];
-        gyro_sum[1] += raw_gyro[1];
-        gyro_sum[2] += raw_gyro[2];
+        // 累加数据（Z轴加速度减去1g的原始值）
+        MPU6500_CalibAdd(hmpu, &st, raw);
+        if (st.window.n == MPU6500_CALIB_WINDOW || st.total.n + st.window.n >= samples) {
+            MPU6500_CalibEndWindow(&st);
+            if (st.rejected > MPU6500_CALIB_MAX_REJECTS) {
+                status = HAL_ERROR;     // 传感器一直在动，不提交偏移值
+                break;
+            }
+        }
         
         // 短暂延迟以确保采样均匀
-        HAL_Delay(5);
+        hmpu->bus->delay(5);
     }
     
-    // 计算平均偏移值
-    accel_offset[0] = (int16_t)(accel_sum[0] / samples);
-    accel_offset[1] = (int16_t)(accel_sum[1] / samples);
-    accel_offset[2] = (int16_t)(accel_sum[2] / samples);
-    
-    gyro_offset[0] = (int16_t)(gyro_sum[0] / samples);
-    gyro_offset[1] = (int16_t)(gyro_sum[1] / samples);
-    gyro_offset[2] = (int16_t)(gyro_sum[2] / samples);
+    // 计算平均偏移值，失败时也填写结果
+    MPU6500_CalibFinish(hmpu, &st, status == HAL_OK, result);
     
+    return status;
+}
+
+/**
+ * @brief Calibrate the offsets from FIFO bursts at the output data rate
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param config Parameters, NULL for the MPU6500_CALIB_xxx defaults
+ * @param result Pointer to store the sample count and quality figures, or NULL
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if more than
+ *         max_rejects windows were rejected, HAL_TIMEOUT if the FIFO
+ *         stopped delivering, error on failure
+ */
+HAL_StatusTypeDef MPU6500_FastOffsetCalibration(MPU6500_Handle *hmpu, const MPU6500_CalibConfig *config, MPU6500_CalibResult *result){
+    static const MPU6500_CalibConfig defaults = {
+        MPU6500_CALIB_MIN_SAMPLES, MPU6500_CALIB_MAX_SAMPLES, MPU6500_CALIB_ACCEL_TOL_G, MPU6500_CALIB_GYRO_TOL_DPS,
+        MPU6500_CALIB_ACCEL_NOISE_G, MPU6500_CALIB_GYRO_NOISE_DPS, MPU6500_CALIB_MAX_REJECTS
+    };
+    HAL_StatusTypeDef status, restore;
+    MPU6500_FIFO_Batch batch;
+    MPU6500_CalibState st;
+    uint8_t buffer[MPU6500_CALIB_BATCH * 12];   // Accel + gyro frames
+    uint8_t channels = hmpu->fifo.channels;
+    int16_t raw[6];
+    float last[6], tol[6], mean;
+    uint32_t wait_ms, timeout_ms, start;
+    uint16_t f;
+    uint8_t i, converged = 0, settled;
+
+    if(config == NULL) config = &defaults;
+    if(config->max_samples == 0) return HAL_ERROR;
+    for(i = 0; i < 3; i++){
+        tol[i] = config->accel_tol_g * hmpu->accel_sens;   // Tolerances in raw LSB
+        tol[3 + i] = config->gyro_tol_dps * hmpu->gyro_sens;
+        last[i] = last[3 + i] = 0.0f;
+    }
+    MPU6500_CalibBegin(hmpu, &st, config->accel_noise_g, config->gyro_noise_dps);
+
+    status = MPU6500_WakeUp(hmpu);
+    if(status != HAL_OK) return status;
+    status = MPU6500_FIFO_Enable(hmpu, MPU6500_FIFO_ACCEL | MPU6500_FIFO_GYRO);
+    if(status != HAL_OK) return status;
+    // Wait for about one batch per drain, give up 1/8 after the longest possible run
+    wait_ms = (uint32_t)((uint64_t)MPU6500_CALIB_BATCH * MPU6500_SamplePeriodNs(hmpu) / 1000000U);
+    if(wait_ms == 0) wait_ms = 1;
+    timeout_ms = (uint32_t)((uint64_t)(config->max_samples + (config->max_rejects + 1U) * MPU6500_CALIB_WINDOW) *
+                            MPU6500_SamplePeriodNs(hmpu) * 9U / 8U / 1000000U) + 1U;
+    start = HAL_GetTick();
+
+    batch.backlog = 0;
+    while(st.total.n < config->max_samples && !converged && status == HAL_OK){
+        if(batch.backlog == 0) hmpu->bus->delay(wait_ms);
+        if(HAL_GetTick() - start > timeout_ms){
+            status = HAL_TIMEOUT;
+            break;
+        }
+        status = MPU6500_FIFO_Read(hmpu, buffer, MPU6500_CALIB_BATCH, &batch);
+        if(status != HAL_OK) break;
+
+        for(f = 0; f < batch.frames && !converged; f++){
+            const uint8_t *frame = &buffer[f * 12];
+            for(i = 0; i < 6; i++){
+                raw[i] = (int16_t)((frame[2 * i] << 8) | frame[2 * i + 1]);
+            }
+            MPU6500_CalibAdd(hmpu, &st, raw);
+            if(st.window.n < MPU6500_CALIB_WINDOW && st.total.n + st.window.n < config->max_samples) continue;
+
+            if(!MPU6500_CalibEndWindow(&st)){
+                // Sensor moved: drop the window and retry, unless it keeps moving
+                if(st.rejected > config->max_rejects){
+                    status = HAL_ERROR;
+                    break;
+                }
+                continue;
+            }
+            settled = 1;
+            for(i = 0; i < 6; i++){
+                mean = MPU6500_CalibMean(&st, i);
+                if(mean - last[i] > tol[i] || last[i] - mean > tol[i]) settled = 0;
+                last[i] = mean;
+            }
+            converged = (st.total.n >= config->min_samples) && settled;
+            if(st.total.n >= config->max_samples) break;
+        }
+    }
+
+    // Restart streaming as it was, but report the first error
+    restore = (channels != 0) ? MPU6500_FIFO_Enable(hmpu, channels) : MPU6500_FIFO_Disable(hmpu);
+    if(status == HAL_OK) status = restore;
+    MPU6500_CalibFinish(hmpu, &st, status == HAL_OK, result);
+    if(result != NULL) result->converged = converged;
+    return status;
+}
+
+/**
+ * @brief Move the calibration offsets into the sensor's offset registers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sensors MPU6500_OFFSET_xxx
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_ApplyHardwareOffsets(MPU6500_Handle *hmpu, uint8_t sensors){
+    HAL_StatusTypeDef status;
+    uint8_t buffer[8], i;
+    int16_t current;
+
+    if(sensors & MPU6500_OFFSET_GYRO){
+        status = MPU6500_ReadRegisters(hmpu, XG_OFFSET_H, buffer, 6);
+        if(status != HAL_OK) return status;
+        for(i = 0; i < 3; i++){
+            current = (int16_t)((buffer[2 * i] << 8) | buffer[2 * i + 1]);
+            // Bias in °/s times the register sensitivity, subtracted from the output
+            hmpu->hw_offset.gyro[i] = MPU6500_RoundInt16((float)current -
+                (float)hmpu->gyro_offset[i] * hmpu->gyro_scale * MPU6500_GYRO_OFFSET_SENS);
+        }
+        status = MPU6500_WriteOffsetRegisters(hmpu, MPU6500_OFFSET_GYRO);
+        if(status != HAL_OK) return status;
+        hmpu->hw_offset.sensors |= MPU6500_OFFSET_GYRO;
+        memset(hmpu->gyro_offset, 0, sizeof(hmpu->gyro_offset));
+    }
+    if(sensors & MPU6500_OFFSET_ACCEL){
+        // XA_OFFSET_H (0x77) .. ZA_OFFSET_L (0x7E), pairs at 0/1, 3/4, 6/7
+        status = MPU6500_ReadRegisters(hmpu, XA_OFFSET_H, buffer, 8);
+        if(status != HAL_OK) return status;
+        for(i = 0; i < 3; i++){
+            current = (int16_t)((buffer[3 * i] << 8) | buffer[3 * i + 1]);
+            // Value sits in bits [15:1]: round the correction to a 0.98 mg step (2 LSB)
+            current = MPU6500_RoundInt16((float)current - 2.0f * (float)MPU6500_RoundInt16(
+                (float)hmpu->accel_offset[i] * hmpu->accel_scale * MPU6500_ACCEL_OFFSET_SENS * 0.5f));
+            hmpu->hw_offset.accel[i] = (int16_t)((current & ~1) | (buffer[3 * i + 1] & 0x01));
+        }
+        status = MPU6500_WriteOffsetRegisters(hmpu, MPU6500_OFFSET_ACCEL);
+        if(status != HAL_OK) return status;
+        hmpu->hw_offset.sensors |= MPU6500_OFFSET_ACCEL;
+        memset(hmpu->accel_offset, 0, sizeof(hmpu->accel_offset));
+    }
     return HAL_OK;
 }
 
 /**
  * @brief 打印MPU6500的偏移校准值
+ * @param hmpu Pointer to the MPU6500 handle
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  * @note 此函数将打印加速度计和陀螺仪的偏移校准值到串口
  */
-HAL_StatusTypeDef MPU6500_PrintOffsets(void) {
+HAL_StatusTypeDef MPU6500_PrintOffsets(MPU6500_Handle *hmpu) {
     // 打印加速度计偏移值
     printf("Accelerometer Offsets:\n");
-    printf("X: %d\n", accel_offset[0]);
-    printf("Y: %d\n", accel_offset[1]);
-    printf("Z: %d\n", accel_offset[2]);
+    printf("X: %d\n", hmpu->accel_offset[0]);
+    printf("Y: %d\n", hmpu->accel_offset[1]);
+    printf("Z: %d\n", hmpu->accel_offset[2]);
     
     // 打印陀螺仪偏移值
     printf("Gyroscope Offsets:\n");
-    printf("X: %d\n", gyro_offset[0]);
-    printf("Y: %d\n", gyro_offset[1]);
-    printf("Z: %d\n", gyro_offset[2]);
+    printf("X: %d\n", hmpu->gyro_offset[0]);
+    printf("Y: %d\n", hmpu->gyro_offset[1]);
+    printf("Z: %d\n", hmpu->gyro_offset[2]);
     
     return HAL_OK;
 }
\ No newline at end of file
@@ -44,11 +44,40 @@ extern "C" {
 #define MPU6500_ACCEL_SENS_8G      4096.0f
 #define MPU6500_ACCEL_SENS_16G     2048.0f
 
+/* 陀螺仪数字低通滤波器（CONFIG DLPF_CFG），带宽 / 群延迟 / 内部采样率 */
+#define MPU6500_GYRO_DLPF_250HZ    0     // 250 Hz, 0.97 ms, 8 kHz
+#define MPU6500_GYRO_DLPF_184HZ    1     // 184 Hz, 2.9 ms, 1 kHz
+#define MPU6500_GYRO_DLPF_92HZ     2     // 92 Hz, 3.9 ms, 1 kHz
+#define MPU6500_GYRO_DLPF_41HZ     3     // 41 Hz, 5.9 ms, 1 kHz
+#define MPU6500_GYRO_DLPF_20HZ     4     // 20 Hz, 9.9 ms, 1 kHz
+#define MPU6500_GYRO_DLPF_10HZ     5     // 10 Hz, 17.85 ms, 1 kHz
+#define MPU6500_GYRO_DLPF_5HZ      6     // 5 Hz, 33.48 ms, 1 kHz
+#define MPU6500_GYRO_DLPF_3600HZ   7     // 3600 Hz, 0.17 ms, 8 kHz
+
+/* 加速度计数字低通滤波器（ACCEL_CONFIG_2 A_DLPF_CFG），带宽 / 群延迟，内部采样率 1 kHz */
+#define MPU6500_ACCEL_DLPF_460HZ   0     // 460 Hz, 1.94 ms (7 is the same)
+#define MPU6500_ACCEL_DLPF_184HZ   1     // 184 Hz, 5.80 ms
+#define MPU6500_ACCEL_DLPF_92HZ    2     // 92 Hz, 7.80 ms
+#define MPU6500_ACCEL_DLPF_41HZ    3     // 41 Hz, 11.80 ms
+#define MPU6500_ACCEL_DLPF_20HZ    4     // 20 Hz, 19.80 ms
+#define MPU6500_ACCEL_DLPF_10HZ    5     // 10 Hz, 35.70 ms
+#define MPU6500_ACCEL_DLPF_5HZ     6     // 5 Hz, 66.96 ms
+
+/* 高速旁路模式：绕过数字低通滤波器（GYRO_CONFIG FCHOICE_B / ACCEL_CONFIG_2 ACCEL_FCHOICE_B） */
+#define MPU6500_GYRO_BYPASS_OFF      0x00  // DLPF in use (FCHOICE_B = 00)
+#define MPU6500_GYRO_BYPASS_8800HZ   0x01  // FCHOICE_B = x1: 8800 Hz, 0.064 ms, 32 kHz
+#define MPU6500_GYRO_BYPASS_3600HZ   0x02  // FCHOICE_B = 10: 3600 Hz, 0.11 ms, 32 kHz
+#define MPU6500_ACCEL_BYPASS_OFF     0x00  // DLPF in use (ACCEL_FCHOICE_B = 0)
+#define MPU6500_ACCEL_BYPASS_1130HZ  0x08  // ACCEL_FCHOICE_B = 1: 1130 Hz, 0.75 ms, 4 kHz
+
 /* 默认配置设置 */
 #define MPU6500_DEFAULT_ACCEL_CONFIG  MPU6500_ACCEL_FS_4G        // 默认加速度计量程：±4g
 #define MPU6500_DEFAULT_GYRO_CONFIG   MPU6500_GYRO_FS_500DPS     // 默认陀螺仪量程：±500°/s
+#define MPU6500_DEFAULT_ACCEL_DLPF    MPU6500_ACCEL_DLPF_20HZ    // 默认加速度计滤波：20 Hz
+#define MPU6500_DEFAULT_GYRO_DLPF     MPU6500_GYRO_DLPF_20HZ     // 默认陀螺仪滤波：20 Hz
+#define MPU6500_DEFAULT_SMPLRT_DIV    0                          // 默认输出速率：1 kHz
 
-/* 根据默认陀螺仪配置动态选择灵敏度 */
+/* 旧版兼容：根据默认陀螺仪配置选择灵敏度（驱动不使用，运行时灵敏度见 hmpu->gyro_sens） */
 #if MPU6500_DEFAULT_GYRO_CONFIG == MPU6500_GYRO_FS_250DPS
   #define MPU6500_GYRO_SENS  MPU6500_GYRO_SENS_250DPS
 #elif MPU6500_DEFAULT_GYRO_CONFIG == MPU6500_GYRO_FS_500DPS
@@ -61,7 +90,7 @@ extern "C" {
   #error "Invalid gyroscope configuration"
 #endif
 
-/* 根据默认加速度计配置动态选择灵敏度 */
+/* 旧版兼容：根据默认加速度计配置选择灵敏度（驱动不使用，运行时灵敏度见 hmpu->accel_sens） */
 #if MPU6500_DEFAULT_ACCEL_CONFIG == MPU6500_ACCEL_FS_2G
   #define MPU6500_ACCEL_SENS  MPU6500_ACCEL_SENS_2G
 #elif MPU6500_DEFAULT_ACCEL_CONFIG == MPU6500_ACCEL_FS_4G
@@ -74,46 +103,589 @@ extern "C" {
   #error "Invalid accelerometer configuration"
 #endif
 
+/* 温度转换常量：Temp(°C) = TEMP_OUT / MPU6500_TEMP_SENS + MPU6500_TEMP_OFFSET */
+#define MPU6500_TEMP_SENS          333.87f
+#define MPU6500_TEMP_OFFSET        21.0f
+
+/* 国际单位换算常量 */
+#define MPU6500_GRAVITY            9.80665f          // m/s² per g
+#define MPU6500_DEG_TO_RAD         0.0174532925f     // rad per degree
+
 #define MPU6500_INT_Pin        MPU_INT_Pin
 #define MPU6500_INT_GPIO_Port  MPU_INT_GPIO_Port
 
 /* MPU6500 I2C Address */
-#define MPU6500_ADDR		0x69 // AD0 = 0 -> 0x68 || AD0 = 1 -> 0x69
+#define MPU6500_ADDR_AD0_LOW   0x68 // AD0 = 0
+#define MPU6500_ADDR_AD0_HIGH  0x69 // AD0 = 1
+#define MPU6500_ADDR		MPU6500_ADDR_AD0_HIGH // Default address
+
+/*
+ * SPI: mode 3 (CPOL = 1, CPHA = 1), MSB first, software NSS.
+ * Configuration registers must be written at <= 1 MHz; sensor and interrupt
+ * registers can be read at up to 20 MHz (a 14-byte frame takes < 10 µs).
+ */
+
+/* 总线类型 */
+#define MPU6500_BUS_I2C            0
+#define MPU6500_BUS_SPI            1
+
+/* 非阻塞读取的传输机制（transport read_async 的 mode 参数） */
+#define MPU6500_ASYNC_DMA          0
+#define MPU6500_ASYNC_IT           1
+
+/**
+ * @brief Classification of a failed bus transfer
+ */
+typedef enum {
+    MPU6500_BUS_ERR_NONE = 0,   // No error recorded
+    MPU6500_BUS_ERR_NACK,       // Address or data byte not acknowledged
+    MPU6500_BUS_ERR_BUS,        // Bus error, arbitration lost or bus held busy
+    MPU6500_BUS_ERR_TIMEOUT,    // Transfer did not complete in time
+    MPU6500_BUS_ERR_OTHER,      // Overrun, DMA or other peripheral error
+    MPU6500_BUS_ERR_BUSY        // Peripheral still running another transfer, the bus is fine
+} MPU6500_BusError;
+
+/**
+ * @brief Bus transport used for every register access
+ * @note All register addresses are 8-bit, the device address is the 7-bit
+ *       I2C address (SPI transports ignore it). Optional members may be NULL.
+ */
+typedef struct {
+    uint8_t type;   // MPU6500_BUS_I2C or MPU6500_BUS_SPI
+    /* Blocking burst read of len bytes starting at reg */
+    HAL_StatusTypeDef (*read)(void *ctx, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t len, uint32_t timeout);
+    /* Blocking burst write of len bytes starting at reg */
+    HAL_StatusTypeDef (*write)(void *ctx, uint8_t addr, uint8_t reg, const uint8_t *data, uint16_t len, uint32_t timeout);
+    /* Start a non-blocking read (mode: MPU6500_ASYNC_DMA or MPU6500_ASYNC_IT) */
+    HAL_StatusTypeDef (*read_async)(void *ctx, uint8_t addr, uint8_t reg, uint8_t *data, uint16_t len, uint8_t mode);
+    /* Optional: called when a non-blocking read has finished or failed */
+    void (*read_async_end)(void *ctx);
+    /* Optional: stop a non-blocking read that overran the read timeout */
+    void (*abort)(void *ctx, uint8_t addr);
+    /* Optional: classify the error of the last failed transfer. After HAL_BUSY,
+       return MPU6500_BUS_ERR_BUSY if the peripheral is running another transfer */
+    MPU6500_BusError (*error)(void *ctx);
+    /* Optional: return a stuck bus and its peripheral to a usable state */
+    HAL_StatusTypeDef (*recover)(void *recover_ctx);
+    /* Millisecond delay */
+    void (*delay)(uint32_t ms);
+    void *ctx;      // Transport specific context (e.g. I2C_HandleTypeDef *)
+    void *recover_ctx;  // Context passed to recover
+    uint32_t clock_hz;  // Bus clock, used to estimate transfer durations
+} MPU6500_Transport;
+
+#ifdef HAL_I2C_MODULE_ENABLED
+/**
+ * @brief I2C pins used to clock a stuck bus free
+ * @note The pins are driven as open-drain GPIO during recovery and handed
+ *       back to the peripheral by HAL_I2C_Init (HAL_I2C_MspInit).
+ */
+typedef struct {
+    I2C_HandleTypeDef *hi2c;    // I2C handle the pins belong to
+    GPIO_TypeDef *scl_port;     // SCL GPIO port
+    uint16_t scl_pin;           // SCL GPIO pin
+    GPIO_TypeDef *sda_port;     // SDA GPIO port
+    uint16_t sda_pin;           // SDA GPIO pin
+} MPU6500_I2C_Recovery;
+
+/* Busy-wait iterations per half SCL period of the bus clear (slow is safe) */
+#ifndef MPU6500_UNSTICK_DELAY
+#define MPU6500_UNSTICK_DELAY      200
+#endif
+#endif
+
+#ifdef HAL_SPI_MODULE_ENABLED
+/**
+ * @brief Context of the built-in SPI transport
+ */
+typedef struct {
+    SPI_HandleTypeDef *hspi;    // SPI handle (mode 3, 8-bit, MSB first)
+    GPIO_TypeDef *cs_port;      // Chip select GPIO port
+    uint16_t cs_pin;            // Chip select GPIO pin (active low)
+    uint8_t dual_speed;         // 1: switch prescalers per access, 0: keep the hspi setting
+    uint32_t fast_prescaler;    // SPI_BAUDRATEPRESCALER_x for sensor data and FIFO reads (<= 20 MHz)
+    uint32_t slow_prescaler;    // SPI_BAUDRATEPRESCALER_x for all other accesses (<= 1 MHz)
+} MPU6500_SPI_Bus;
+#endif
+
+/* INT_STATUS 中断标志位 */
+#define MPU6500_INT_WOM            0x40  // WOM_INT: wake on motion
+#define MPU6500_INT_FIFO_OFLOW     0x10  // FIFO_OFLOW_INT: FIFO overflow
+#define MPU6500_INT_FSYNC          0x08  // FSYNC_INT: FSYNC interrupt
+#define MPU6500_INT_RAW_DATA_RDY   0x01  // RAW_DATA_RDY_INT: new sensor data
+
+/* Number of bytes from ACCEL_XOUT_H (0x3B) to GYRO_ZOUT_L (0x48) */
+#define MPU6500_SAMPLE_SIZE    14
+
+/**
+ * @brief Raw sensor frame as laid out in ACCEL_XOUT_H..GYRO_ZOUT_L
+ */
+typedef struct {
+    int16_t accel[3];   // Raw accelerometer X/Y/Z
+    int16_t temp;       // Raw temperature
+    int16_t gyro[3];    // Raw gyroscope X/Y/Z
+} MPU6500_RawSample;
+
+/**
+ * @brief Sensor frame converted to physical units
+ */
+typedef struct {
+    float accel[3];     // Acceleration X/Y/Z in g
+    float gyro[3];      // Angular rate X/Y/Z in degrees per second
+    float temp;         // Temperature in °C
+    uint8_t accel_fs;   // Accelerometer range the frame was converted with (MPU6500_ACCEL_FS_xxx)
+    uint8_t gyro_fs;    // Gyroscope range the frame was converted with (MPU6500_GYRO_FS_xxx)
+    uint8_t settling;   // Frame may predate the last range switch, discard it
+} MPU6500_Sample;
+
+/* 定点输出格式 */
+#define MPU6500_FIXED_Q16          0     // Q16.16 g, °/s, °C
+#define MPU6500_FIXED_MILLI        1     // mg, m°/s, m°C
 
-/* Change this according to your I2C handle declared in main.c */
-extern I2C_HandleTypeDef hi2c1; 
+/**
+ * @brief Sensor frame converted to fixed-point units (MPU6500_FIXED_xxx)
+ */
+typedef struct {
+    int32_t accel[3];   // Acceleration X/Y/Z in Q16.16 g or mg
+    int32_t gyro[3];    // Angular rate X/Y/Z in Q16.16 °/s or m°/s
+    int32_t temp;       // Temperature in Q16.16 °C or m°C
+    uint8_t accel_fs;   // Accelerometer range the frame was converted with (MPU6500_ACCEL_FS_xxx)
+    uint8_t gyro_fs;    // Gyroscope range the frame was converted with (MPU6500_GYRO_FS_xxx)
+    uint8_t settling;   // Frame may predate the last range switch, discard it
+} MPU6500_FixedSample;
+
+/* 非阻塞读取的通道选择（可组合） */
+#define MPU6500_READ_ACCEL         0x01  // ACCEL_XOUT_H..ACCEL_ZOUT_L (6 bytes)
+#define MPU6500_READ_TEMP          0x02  // TEMP_OUT_H..TEMP_OUT_L (2 bytes)
+#define MPU6500_READ_GYRO          0x04  // GYRO_XOUT_H..GYRO_ZOUT_L (6 bytes)
+#define MPU6500_READ_BURST         0x08  // Whole 14-byte frame in one transfer
+
+/* Number of times a NACKed non-blocking transfer step is re-issued */
+#define MPU6500_ASYNC_MAX_RETRIES  3
+
+/**
+ * @brief State of the non-blocking sample acquisition
+ */
+typedef enum {
+    MPU6500_ASYNC_IDLE = 0,     // No transfer pending, no unread sample
+    MPU6500_ASYNC_BUSY,         // Transfer in progress
+    MPU6500_ASYNC_READY,        // Transfer completed, sample available
+    MPU6500_ASYNC_ERROR         // Transfer failed
+} MPU6500_AsyncState;
+
+/* 寄存器影子缓存索引（MPU6500_Handle.shadow） */
+#define MPU6500_SHADOW_SMPLRT_DIV      0   // SMPLRT_DIV (0x19)
+#define MPU6500_SHADOW_CONFIG          1   // CONFIG (0x1A)
+#define MPU6500_SHADOW_GYRO_CONFIG     2   // GYRO_CONFIG (0x1B)
+#define MPU6500_SHADOW_ACCEL_CONFIG    3   // ACCEL_CONFIG (0x1C)
+#define MPU6500_SHADOW_ACCEL_CONFIG_2  4   // ACCEL_CONFIG_2 (0x1D)
+#define MPU6500_SHADOW_FIFO_EN         5   // FIFO_EN (0x23)
+#define MPU6500_SHADOW_INT_PIN_CFG     6   // INT_PIN_CFG (0x37)
+#define MPU6500_SHADOW_INT_ENABLE      7   // INT_ENABLE (0x38)
+#define MPU6500_SHADOW_USER_CTRL       8   // USER_CTRL (0x6A)
+#define MPU6500_SHADOW_PWR_MGMT_1      9   // PWR_MGMT_1 (0x6B)
+#define MPU6500_SHADOW_PWR_MGMT_2      10  // PWR_MGMT_2 (0x6C)
+#define MPU6500_SHADOW_COUNT           11
+
+/*
+ * Define MPU6500_SHADOW_CHECK to read back every shadowed register after it
+ * is written and fail with HAL_ERROR on a mismatch (debug builds only, it
+ * doubles the bus traffic of configuration changes).
+ */
+
+/* 默认传输超时（毫秒），HAL 超时以 SysTick 为粒度 */
+#define MPU6500_DEFAULT_READ_TIMEOUT   5   // Sensor data reads
+#define MPU6500_DEFAULT_WRITE_TIMEOUT  10  // Configuration writes
+
+/* Fixed per-transfer software overhead used by deadline estimates (µs) */
+#define MPU6500_XFER_OVERHEAD_US       20
+
+/* 默认重试策略 */
+#define MPU6500_DEFAULT_RETRIES        2   // Retries after the first failed attempt
+#define MPU6500_DEFAULT_BACKOFF_MS     1   // Delay before the first retry, doubled per retry
+#define MPU6500_DEFAULT_BACKOFF_MAX_MS 8   // Upper bound of the retry delay
+
+/**
+ * @brief Retry policy of blocking transfers
+ */
+typedef struct {
+    uint8_t max_retries;        // Retries after the first failed attempt (0 disables retrying)
+    uint16_t backoff_ms;        // Delay before the first retry, doubled for every further retry
+    uint16_t backoff_max_ms;    // Upper bound of the retry delay
+} MPU6500_RetryPolicy;
+
+/* FIFO 通道选择（FIFO_EN 寄存器位），帧内按寄存器地址顺序排列 */
+#define MPU6500_FIFO_TEMP          0x80  // TEMP_OUT (2 bytes)
+#define MPU6500_FIFO_GYRO          0x70  // GYRO_XOUT..GYRO_ZOUT (6 bytes)
+#define MPU6500_FIFO_ACCEL         0x08  // ACCEL_XOUT..ACCEL_ZOUT (6 bytes)
+#define MPU6500_FIFO_ALL           (MPU6500_FIFO_ACCEL | MPU6500_FIFO_TEMP | MPU6500_FIFO_GYRO)
+
+/* FIFO capacity in bytes */
+#define MPU6500_FIFO_SIZE          512
+
+/**
+ * @brief Result of one FIFO drain
+ */
+typedef struct {
+    uint16_t frames;    // Frames copied to the caller buffer
+    uint8_t resync;     // 1 if the FIFO was reset: samples are missing before the next batch
+    uint32_t lost;      // Estimated number of samples in the gap (0 unless resync)
+    uint16_t backlog;   // Complete frames left in the FIFO after this batch
+    uint64_t time_us;   // Clock reading taken right after FIFO_COUNT was read
+} MPU6500_FIFO_Batch;
+
+/* Timestamp smoothing: fraction (1 / 2^n) of a late drain applied per batch */
+#define MPU6500_TS_SMOOTH_SHIFT    6
+
+/* Samples over which the phase corrections are averaged into a period update */
+#define MPU6500_DRIFT_WINDOW       2048
+
+/* Largest accepted deviation of the sample period from nominal (ppm) */
+#define MPU6500_DRIFT_LIMIT_PPM    20000
+
+/**
+ * @brief Destination arrays of a decoded FIFO block (structure of arrays)
+ * @note Each non-NULL array needs room for one value per frame. Channels
+ *       that are NULL or not in the FIFO are skipped.
+ */
+typedef struct {
+    int16_t *accel[3];  // Raw accelerometer X/Y/Z
+    int16_t *temp;      // Raw temperature
+    int16_t *gyro[3];   // Raw gyroscope X/Y/Z
+} MPU6500_RawChannels;
+
+/**
+ * @brief Destination arrays of a FIFO block converted to physical units
+ * @note Same rules as MPU6500_RawChannels.
+ */
+typedef struct {
+    float *accel[3];    // Acceleration X/Y/Z in g
+    float *temp;        // Temperature in °C
+    float *gyro[3];     // Angular rate X/Y/Z in degrees per second
+} MPU6500_Channels;
+
+/* 自动量程切换 */
+#define MPU6500_AUTORANGE_OFF      0x00
+#define MPU6500_AUTORANGE_ACCEL    0x01  // Auto-range the accelerometer
+#define MPU6500_AUTORANGE_GYRO     0x02  // Auto-range the gyroscope
+#define MPU6500_AUTORANGE_ALL      0x03
+#define MPU6500_AUTORANGE_HIGH     30000 // Raw |value| that steps the range up (~92% of full scale)
+#define MPU6500_AUTORANGE_LOW      12000 // Raw |value| all axes must stay below to step down (~73% of the lower range)
+#define MPU6500_AUTORANGE_HOLD     200   // Quiet samples required before stepping down
+#define MPU6500_AUTORANGE_SETTLE   1     // Samples flagged as settling after a range switch
+
+/* 硬件偏移寄存器（XG/XA_OFFSET） */
+#define MPU6500_OFFSET_ACCEL       0x01  // XA/YA/ZA_OFFSET (0.98 mg steps, bit 0 reserved)
+#define MPU6500_OFFSET_GYRO        0x02  // XG/YG/ZG_OFFSET (±1000°/s format, 32.8 LSB/°/s)
+#define MPU6500_OFFSET_ALL         0x03
+#define MPU6500_GYRO_OFFSET_SENS   32.8f // Gyro offset register LSB/°/s
+#define MPU6500_ACCEL_OFFSET_SENS  2048.0f // Accel offset register LSB/g (read as 16 bits)
+
+/* 快速校准默认参数 */
+#define MPU6500_CALIB_MIN_SAMPLES  128   // Samples collected before convergence is checked
+#define MPU6500_CALIB_MAX_SAMPLES  256   // Upper bound of the samples collected
+#define MPU6500_CALIB_ACCEL_TOL_G  0.0005f // Converged when the accel means move less per batch (g)
+#define MPU6500_CALIB_GYRO_TOL_DPS 0.01f // Converged when the gyro means move less per batch (°/s)
+#define MPU6500_CALIB_BATCH        16    // FIFO frames drained per batch, leaves room for the I2C drain time
+#define MPU6500_CALIB_WINDOW       32    // Samples per variance check window
+#define MPU6500_CALIB_ACCEL_NOISE_G 0.02f // Largest accel standard deviation of an accepted window (g)
+#define MPU6500_CALIB_GYRO_NOISE_DPS 1.0f // Largest gyro standard deviation of an accepted window (°/s)
+#define MPU6500_CALIB_MAX_REJECTS  3     // Rejected windows tolerated before calibration fails
+
+/**
+ * @brief Parameters of MPU6500_FastOffsetCalibration
+ */
+typedef struct {
+    uint32_t min_samples;       // Samples always collected before convergence is checked
+    uint32_t max_samples;       // Upper bound of the samples collected
+    float accel_tol_g;          // Largest change of any accel mean per batch still counted as converged
+    float gyro_tol_dps;         // Largest change of any gyro mean per batch still counted as converged
+    float accel_noise_g;        // Windows with a larger accel standard deviation are rejected (0 = unchecked)
+    float gyro_noise_dps;       // Windows with a larger gyro standard deviation are rejected (0 = unchecked)
+    uint8_t max_rejects;        // Rejected windows tolerated before calibration fails
+} MPU6500_CalibConfig;
+
+/**
+ * @brief Outcome of MPU6500_FastOffsetCalibration and MPU6500_InitOffsetCalibrationEx
+ */
+typedef struct {
+    uint32_t samples;           // Samples averaged into the offsets
+    uint8_t converged;          // 1 if the means settled before max_samples (fast calibration only)
+    uint32_t windows;           // Windows accepted
+    uint32_t rejected;          // Windows rejected because the sensor moved
+    float accel_noise_g;        // Largest accel standard deviation of the accepted samples
+    float gyro_noise_dps;       // Largest gyro standard deviation of the accepted samples
+    uint8_t quality;            // Accepted share of all windows (0..100 %)
+} MPU6500_CalibResult;
+
+/**
+ * @brief Characteristics of a digital low pass filter setting
+ */
+typedef struct {
+    float bandwidth_hz;     // -3 dB bandwidth
+    uint32_t delay_us;      // Group delay
+    uint16_t rate_hz;       // Internal sample rate, divided by 1 + SMPLRT_DIV when 1 kHz
+} MPU6500_FilterInfo;
+
+/**
+ * @brief Bus event counters of one sensor
+ */
+typedef struct {
+    uint32_t timeouts;          // Transfers that returned HAL_TIMEOUT
+    uint32_t deadline_skips;    // Reads refused because they could not meet their deadline
+    uint32_t nacks;             // Transfers not acknowledged by the sensor
+    uint32_t bus_errors;        // Bus errors, lost arbitration or bus held busy
+    uint32_t other_errors;      // Any other failed transfer
+    uint32_t busy;              // Transfers refused while the peripheral ran another one
+    uint32_t retries;           // Transfers repeated by the retry policy
+    uint32_t recoveries;        // Bus clear / peripheral re-init sequences run
+    uint32_t failures;          // Transfers that failed after all retries
+    uint32_t restores;          // Configuration re-applied after a sensor reset
+    uint32_t fifo_overflows;    // FIFO overflows and broken drains that forced a resync
+    uint32_t fifo_lost;         // Estimated FIFO samples dropped by all resyncs
+    uint32_t range_switches;    // Full scale changes made by auto-ranging
+} MPU6500_Stats;
+
+/**
+ * @brief MPU6500 device handle, one per sensor
+ * @note Filled in by MPU6500_Init. Several handles may share one transport
+ *       (e.g. two sensors at 0x68 and 0x69 on the same I2C bus). A blocking
+ *       read that finds the peripheral busy with another sensor's
+ *       non-blocking transfer is retried after the backoff; the bus is not
+ *       recovered, so the running transfer is left alone.
+ */
+typedef struct {
+    const MPU6500_Transport *bus;   // Bus transport the sensor is connected to
+    uint8_t address;                // 7-bit I2C address (ignored on SPI)
+    uint8_t accel_fs;               // Active ACCEL_CONFIG full scale (MPU6500_ACCEL_FS_xxx)
+    uint8_t gyro_fs;                // Active GYRO_CONFIG full scale (MPU6500_GYRO_FS_xxx)
+    float accel_sens;               // Accelerometer sensitivity for accel_fs (LSB/g)
+    float gyro_sens;                // Gyroscope sensitivity for gyro_fs (LSB/°/s)
+    float accel_scale;              // 1 / accel_sens (g/LSB)
+    float gyro_scale;               // 1 / gyro_sens (°/s/LSB)
+    int16_t accel_offset[3];        // Accelerometer calibration offsets (raw LSB)
+    int16_t gyro_offset[3];         // Gyroscope calibration offsets (raw LSB)
+    struct {
+        uint8_t sensors;                // MPU6500_OFFSET_xxx held in the offset registers
+        int16_t accel[3];               // XA/YA/ZA_OFFSET values written
+        int16_t gyro[3];                // XG/YG/ZG_OFFSET values written
+    } hw_offset;
+    uint8_t shadow[MPU6500_SHADOW_COUNT];   // Configured value of each shadowed register
+    uint16_t shadow_dirty;                  // Slots staged but not yet written (bit per slot)
+    uint32_t read_timeout;          // Timeout of blocking data reads (ms)
+    uint32_t write_timeout;         // Timeout of blocking configuration writes (ms)
+    MPU6500_RetryPolicy retry;      // Retry policy of blocking transfers
+    MPU6500_Stats stats;            // Bus event counters
+    uint64_t (*clock_us)(void);     // Microsecond time source for FIFO timestamps, NULL: HAL tick
+    struct {
+        uint8_t channels;                       // MPU6500_FIFO_xxx channels being written to the FIFO
+        uint8_t frame_size;                     // Bytes per FIFO frame, 0 while streaming is off
+        uint8_t resync;                         // Frame alignment lost, reset on the next drain
+        uint16_t backlog;                       // Frames left in the FIFO by the last drain
+        uint32_t tick;                          // HAL tick of the last drain or reset
+    } fifo;
+    struct {
+        uint8_t sensors;                        // MPU6500_AUTORANGE_xxx
+        uint8_t accel_target;                   // Accelerometer range requested by the last samples
+        uint8_t gyro_target;                    // Gyroscope range requested by the last samples
+        uint8_t settle;                         // Samples still to flag as settling
+        uint16_t accel_quiet;                   // Consecutive samples below MPU6500_AUTORANGE_LOW
+        uint16_t gyro_quiet;
+        uint8_t prev_accel_fs;                  // Ranges before the last switch, settling samples use them
+        uint8_t prev_gyro_fs;
+        int16_t prev_accel_offset[3];           // Offsets before the last rescale
+        int16_t prev_gyro_offset[3];
+    } autorange;
+    struct {
+        int64_t next_ns;                        // Estimated sample time of the next frame drained
+        uint16_t next_frac;                     // Fraction of next_ns (1/65536 ns)
+        uint8_t valid;                          // next_ns holds an estimate
+        uint32_t nominal_ns;                    // Sample period of the configured ODR
+        uint64_t period_q16;                    // Measured sample period (ns, 16 fraction bits)
+        int64_t drift_ns;                       // Phase corrections in the current drift window
+        uint32_t drift_span;                    // Samples in the current drift window
+    } ts;
+    /* Non-blocking acquisition context, shared with the bus completion IRQ */
+    struct {
+        volatile MPU6500_AsyncState state;
+        uint8_t mode;                           // MPU6500_ASYNC_DMA or MPU6500_ASYNC_IT
+        uint8_t pending;                        // MPU6500_READ_xxx steps not yet issued
+        uint8_t step;                           // Step currently on the bus
+        uint8_t retries;                        // Retries used by the current step
+        uint32_t start_tick;                    // HAL tick when the transfer was started
+        uint8_t buffer[MPU6500_SAMPLE_SIZE];    // Transfer destination, converted by MPU6500_GetAsyncSample
+    } async;
+} MPU6500_Handle;
+
+#ifdef HAL_I2C_MODULE_ENABLED
+/**
+ * @brief Set up a transport for the STM32 HAL I2C driver
+ * @param bus Transport to initialize
+ * @param hi2c I2C handle the sensor is connected to
+ * @note Uses HAL_I2C_Mem_Read/Write and HAL_I2C_Mem_Read_DMA/IT.
+ */
+void MPU6500_Transport_InitI2C(MPU6500_Transport *bus, I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief Let the I2C transport clock a stuck bus free during recovery
+ * @param bus Transport set up by MPU6500_Transport_InitI2C
+ * @param recovery I2C handle and SCL/SDA pins, must outlive the transport
+ * @note Without it, recovery only re-initializes the I2C peripheral. With it,
+ *       SCL is toggled up to 9 times until the sensor releases SDA and a STOP
+ *       condition is generated before the peripheral is re-initialized.
+ */
+void MPU6500_Transport_SetI2CRecovery(MPU6500_Transport *bus, MPU6500_I2C_Recovery *recovery);
+#endif
+
+#ifdef HAL_SPI_MODULE_ENABLED
+/**
+ * @brief Set up a transport for the STM32 HAL SPI driver
+ * @param bus Transport to initialize
+ * @param spi SPI handle and chip select pin, must outlive the transport
+ * @note The address byte is sent with bit 7 set for reads, followed by a
+ *       burst receive. Configuration writes must use an SPI clock <= 1 MHz.
+ * @note With dual_speed set, reads of INT_STATUS..EXT_SENS_DATA_23 and
+ *       FIFO_COUNT..FIFO_R_W use fast_prescaler and every other access
+ *       slow_prescaler. The high-rate modes need this, see
+ *       MPU6500_SetHighRateMode.
+ */
+void MPU6500_Transport_InitSPI(MPU6500_Transport *bus, MPU6500_SPI_Bus *spi);
+#endif
 
 /**
  * @brief Initialize the MPU6500 accelerometer and gyroscope    
+ * @param hmpu Pointer to the MPU6500 handle to initialize
+ * @param bus Bus transport the sensor is connected to, must outlive the handle
+ * @param address 7-bit I2C address (MPU6500_ADDR_AD0_LOW/HIGH), ignored on SPI
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Resets the sensor and the handle (offsets are cleared), then applies
+ *       MPU6500_DEFAULT_ACCEL_CONFIG / MPU6500_DEFAULT_GYRO_CONFIG.
+ *       The handle may be uninitialized memory. Do not re-initialize it while
+ *       a non-blocking transfer is running: the completion would be lost.
  */
-HAL_StatusTypeDef MPU6500_Init(void);
+HAL_StatusTypeDef MPU6500_Init(MPU6500_Handle *hmpu, const MPU6500_Transport *bus, uint8_t address);
+
+/**
+ * @brief Reload the register shadow from the sensor
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Configuration updates are write-only and rely on the shadow. Call this
+ *       if the registers may have been changed behind the driver's back
+ *       (e.g. after a sensor brown-out or an external reset). Uncommitted
+ *       changes are discarded.
+ */
+HAL_StatusTypeDef MPU6500_SyncShadow(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Write all staged configuration changes to the sensor
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Dirty registers are grouped into the fewest burst writes: at most one
+ *       per contiguous block (SMPLRT_DIV..ACCEL_CONFIG_2, FIFO_EN,
+ *       INT_PIN_CFG..INT_ENABLE, USER_CTRL..PWR_MGMT_2). Clean registers
+ *       between two dirty ones are rewritten with their shadow value.
+ */
+HAL_StatusTypeDef MPU6500_CommitConfig(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Compare the register shadow with the sensor
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK if every shadowed register matches,
+ *         HAL_ERROR on a mismatch, bus error otherwise
+ * @note Diagnostic helper, the shadow is left unchanged. Registers with
+ *       uncommitted changes are not compared.
+ */
+HAL_StatusTypeDef MPU6500_CheckShadow(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Set the timeouts of blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param read_ms Timeout of data reads in ms (also bounds non-blocking reads)
+ * @param write_ms Timeout of configuration writes in ms
+ * @note Timeouts are counted in HAL ticks, so the effective bound is up to
+ *       one tick longer. HAL_MAX_DELAY restores the unbounded behaviour.
+ */
+void MPU6500_SetTimeouts(MPU6500_Handle *hmpu, uint32_t read_ms, uint32_t write_ms);
+
+/**
+ * @brief Set the retry policy of blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param policy Retry count and backoff delays
+ * @note A transfer that times out, hits a bus error or finds the bus busy runs
+ *       the transport recover hook before it is retried; a NACK is retried
+ *       after the backoff only. Reads with a deadline are only retried while
+ *       the backoff and another transfer still fit the deadline. The last
+ *       failed attempt is recovered as well, so with max_retries = 0 the
+ *       next call still finds a usable bus.
+ *       Retries recover the bus, not the sensor: a sensor that browned out
+ *       acknowledges every transfer but runs its power-on defaults. Pair
+ *       the policy with MPU6500_CheckHealth, see there for the cadence.
+ */
+void MPU6500_SetRetryPolicy(MPU6500_Handle *hmpu, const MPU6500_RetryPolicy *policy);
+
+/**
+ * @brief Check that the sensor still holds its configuration
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK if the sensor is configured (again),
+ *         error if it could not be read or restored
+ * @note A brown-out resets the sensor to its power-on defaults (asleep,
+ *       PWR_MGMT_1 = 0x40). If PWR_MGMT_1 no longer matches the register
+ *       shadow, the cached configuration and any hardware offsets are
+ *       written back in full and stats.restores is incremented.
+ *       Costs one 1-byte read (about 100 µs at 400 kHz I2C) while healthy.
+ *       Call it from the main loop about once per second, and right after
+ *       a call returned an error (stats.failures increased): bus faults and
+ *       brown-outs often share a supply glitch as their cause. Not from
+ *       interrupt context, it may write the whole configuration.
+ */
+HAL_StatusTypeDef MPU6500_CheckHealth(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Estimate how long a register read takes on the bus
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param len Number of data bytes
+ * @return uint32_t Estimated duration in µs, including MPU6500_XFER_OVERHEAD_US
+ * @note Based on the transport clock_hz: 9 bit times per I2C byte (address,
+ *       register and repeated-start address phases included), 8 per SPI byte.
+ */
+uint32_t MPU6500_EstimateReadTime(MPU6500_Handle *hmpu, uint16_t len);
+
+/**
+ * @brief Get the bus event counters
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return const MPU6500_Stats* Counters of this sensor
+ */
+const MPU6500_Stats *MPU6500_GetStats(MPU6500_Handle *hmpu);
 
 /**
  * @brief Enable data ready interrupts from the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  * @note Enables RAW_RDY_EN bit in INT_ENABLE register
  */
-HAL_StatusTypeDef MPU6500_EnableDataReadyInterrupts(void);
+HAL_StatusTypeDef MPU6500_EnableDataReadyInterrupts(MPU6500_Handle *hmpu);
 
 /**
  * @brief Disable data ready interrupts from the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  * @note Disables RAW_RDY_EN bit in INT_ENABLE register
  */
-HAL_StatusTypeDef MPU6500_DisableDataReadyInterrupts(void);
+HAL_StatusTypeDef MPU6500_DisableDataReadyInterrupts(MPU6500_Handle *hmpu);
 
 /**
  * @brief Read the WHO_AM_I register of the MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
  * @param whoami Pointer to store the value read from WHO_AM_I register
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure    
  */
-HAL_StatusTypeDef MPU6500_ReadWhoAmI(uint8_t *whoami);
+HAL_StatusTypeDef MPU6500_ReadWhoAmI(MPU6500_Handle *hmpu, uint8_t *whoami);
 
 
 
 /**
  * @brief Read accelerometer data from MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
  * @param x Pointer to store X-axis acceleration in g
  * @param y Pointer to store Y-axis acceleration in g
  * @param z Pointer to store Z-axis acceleration in g
@@ -121,9 +693,10 @@ HAL_StatusTypeDef MPU6500_ReadWhoAmI(uint8_t *whoami);
  * @note Reads 6 bytes starting from ACCEL_XOUT_H register
  *       Converts raw data to physical units using configured sensitivity
  */
-HAL_StatusTypeDef MPU6500_ReadAccel(float *x, float *y, float *z);
+HAL_StatusTypeDef MPU6500_ReadAccel(MPU6500_Handle *hmpu, float *x, float *y, float *z);
 /**
  * @brief Read raw accelerometer data from MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
  * @param x Pointer to store X-axis raw acceleration data
  * @param y Pointer to store Y-axis raw acceleration data
  * @param z Pointer to store Z-axis raw acceleration data
@@ -131,10 +704,11 @@ HAL_StatusTypeDef MPU6500_ReadAccel(float *x, float *y, float *z);
  * @note Reads 6 bytes starting from ACCEL_XOUT_H register
  *       Data is in 16-bit format, high byte first
  */
-HAL_StatusTypeDef MPU6500_ReadRawAccel(int16_t *x, int16_t *y, int16_t *z);
+HAL_StatusTypeDef MPU6500_ReadRawAccel(MPU6500_Handle *hmpu, int16_t *x, int16_t *y, int16_t *z);
 
 /**
  * @brief Read gyroscope data from MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
  * @param x Pointer to store X-axis gyroscope data in degrees per second
  * @param y Pointer to store Y-axis gyroscope data in degrees per second
  * @param z Pointer to store Z-axis gyroscope data in degrees per second
@@ -142,46 +716,607 @@ HAL_StatusTypeDef MPU6500_ReadRawAccel(int16_t *x, int16_t *y, int16_t *z);
  * @note Reads 6 bytes starting from GYRO_XOUT_H register
  *       Converts raw data to physical units using configured sensitivity
  */
-HAL_StatusTypeDef MPU6500_ReadGyro(float *x, float *y, float *z);
+HAL_StatusTypeDef MPU6500_ReadGyro(MPU6500_Handle *hmpu, float *x, float *y, float *z);
 
 /**
  * @brief Read temperature data from MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
  * @param temp Pointer to store temperature data
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  * @note Reads 2 bytes starting from TEMP_OUT_H register
  *       Data is in 16-bit format, high byte first
  */
-HAL_StatusTypeDef MPU6500_ReadTemp(int16_t *temp);
+HAL_StatusTypeDef MPU6500_ReadTemp(MPU6500_Handle *hmpu, int16_t *temp);
+
+/**
+ * @brief Read raw accelerometer, temperature and gyroscope data in one transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sample Pointer to store the raw sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 14 bytes starting from ACCEL_XOUT_H register, so all seven
+ *       channels belong to the same sample instant. Offsets are not applied.
+ */
+HAL_StatusTypeDef MPU6500_ReadRawAll(MPU6500_Handle *hmpu, MPU6500_RawSample *sample);
+
+/**
+ * @brief Read accelerometer, temperature and gyroscope data in one transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sample Pointer to store the converted sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 14 bytes starting from ACCEL_XOUT_H register, subtracts the
+ *       calibration offsets and converts to g, °/s and °C.
+ *       Replaces a ReadAccel + ReadGyro + ReadTemp sequence (3 transfers).
+ */
+HAL_StatusTypeDef MPU6500_ReadAll(MPU6500_Handle *hmpu, MPU6500_Sample *sample);
+
+/**
+ * @brief Read the sensor frame only if it can complete within a time budget
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sample Pointer to store the converted sensor frame
+ * @param budget_us Time the caller can spend in this call (µs)
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_TIMEOUT if the estimated
+ *         transfer time exceeds the budget (nothing is sent) or the
+ *         transfer timed out, error on failure
+ * @note The bus timeout is derived from the budget (rounded up to whole
+ *       ticks), so a stuck bus cannot hold the caller much past its deadline.
+ *       Failed transfers are retried and recovered like any other read as
+ *       long as the budget allows, and a pending auto-range switch is
+ *       written if the time left covers it.
+ */
+HAL_StatusTypeDef MPU6500_ReadAllWithin(MPU6500_Handle *hmpu, MPU6500_Sample *sample, uint32_t budget_us);
+
+/**
+ * @brief Read INT_STATUS and the raw sensor frame in one transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param int_status Pointer to store the interrupt flags (MPU6500_INT_xxx)
+ * @param sample Pointer to store the raw sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Reads 15 bytes starting from INT_STATUS register. With
+ *       INT_ANYRD_2CLEAR set by MPU6500_Init, this read also clears the
+ *       latched interrupt. Offsets are not applied.
+ */
+HAL_StatusTypeDef MPU6500_ReadRawAllWithStatus(MPU6500_Handle *hmpu, uint8_t *int_status, MPU6500_RawSample *sample);
+
+/**
+ * @brief Read INT_STATUS and the sensor frame in one transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param int_status Pointer to store the interrupt flags (MPU6500_INT_xxx)
+ * @param sample Pointer to store the converted sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Intended for the INT pin EXTI handler: one transfer tells why the
+ *       interrupt fired, clears the latch and returns the data.
+ *       The sample is only meaningful when MPU6500_INT_RAW_DATA_RDY is set.
+ */
+HAL_StatusTypeDef MPU6500_ReadAllWithStatus(MPU6500_Handle *hmpu, uint8_t *int_status, MPU6500_Sample *sample);
+
+/**
+ * @brief Read accelerometer data as fixed-point values
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param format MPU6500_FIXED_Q16 (Q16.16 g) or MPU6500_FIXED_MILLI (mg)
+ * @param x Pointer to store X-axis acceleration
+ * @param y Pointer to store Y-axis acceleration
+ * @param z Pointer to store Z-axis acceleration
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Integer-only counterpart of MPU6500_ReadAccel for targets without
+ *       an FPU. Each axis is (raw - offset) * C / 65536 rounded half up
+ *       (toward +inf), with C the compile-time coefficient of the active
+ *       range. Accel coefficients are exact, so the result is within
+ *       0.5 LSB of the output unit.
+ */
+HAL_StatusTypeDef MPU6500_ReadAccelFixed(MPU6500_Handle *hmpu, uint8_t format, int32_t *x, int32_t *y, int32_t *z);
+
+/**
+ * @brief Read gyroscope data as fixed-point values
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param format MPU6500_FIXED_Q16 (Q16.16 °/s) or MPU6500_FIXED_MILLI (m°/s)
+ * @param x Pointer to store X-axis angular rate
+ * @param y Pointer to store Y-axis angular rate
+ * @param z Pointer to store Z-axis angular rate
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Rounding as MPU6500_ReadAccelFixed. Gyro coefficients are rounded
+ *       to 1/65536 of the output unit per LSB, which adds at most
+ *       32768 * 0.5 / 65536 = 0.25 LSB: the result is within 0.75 LSB of
+ *       the exact value (1.2e-5 °/s in Q16.16, 0.75 m°/s in milli).
+ */
+HAL_StatusTypeDef MPU6500_ReadGyroFixed(MPU6500_Handle *hmpu, uint8_t format, int32_t *x, int32_t *y, int32_t *z);
+
+/**
+ * @brief Read accelerometer, temperature and gyroscope data as fixed-point values
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param format MPU6500_FIXED_Q16 or MPU6500_FIXED_MILLI
+ * @param sample Pointer to store the converted sensor frame
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Integer-only counterpart of MPU6500_ReadAll, including auto-ranging.
+ *       Rounding and error bounds as MPU6500_ReadAccelFixed and
+ *       MPU6500_ReadGyroFixed; temperature is within 0.75 LSB as well.
+ */
+HAL_StatusTypeDef MPU6500_ReadAllFixed(MPU6500_Handle *hmpu, uint8_t format, MPU6500_FixedSample *sample);
+
+/**
+ * @brief Start a non-blocking 14-byte sensor frame read using DMA
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK if the transfer was started,
+ *         HAL_BUSY if a transfer is already in progress, error on failure
+ * @note Uses HAL_I2C_Mem_Read_DMA (HAL_SPI_Receive_DMA in SPI mode), so the
+ *       CPU is free while the bus transfers. Completion is reported through
+ *       MPU6500_I2C_MemRxCpltCallback (MPU6500_SPI_RxCpltCallback), which
+ *       must be called from the matching HAL callback.
+ */
+HAL_StatusTypeDef MPU6500_StartReadAll_DMA(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Start a non-blocking read using interrupt-driven transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param channels Combination of MPU6500_READ_xxx flags
+ * @return HAL_StatusTypeDef HAL_OK if the transfer was started,
+ *         HAL_BUSY if a transfer is already in progress, error on failure
+ * @note For MCUs without a free DMA stream. Each selected channel is read
+ *       with HAL_I2C_Mem_Read_IT (HAL_SPI_Receive_IT) and the next one is chained from the
+ *       completion callback (accel -> temp -> gyro). MPU6500_READ_BURST
+ *       reads the whole frame in a single transfer instead. A step that is
+ *       NACKed is retried up to MPU6500_ASYNC_MAX_RETRIES times.
+ *       Fields of channels that were not requested are not meaningful.
+ */
+HAL_StatusTypeDef MPU6500_StartRead_IT(MPU6500_Handle *hmpu, uint8_t channels);
+
+/**
+ * @brief Get the state of the non-blocking acquisition
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return MPU6500_AsyncState current state
+ */
+MPU6500_AsyncState MPU6500_GetAsyncState(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Fetch the sample produced by the last non-blocking transfer
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sample Pointer to store the converted sensor frame
+ * @return HAL_StatusTypeDef HAL_OK if a sample was copied, HAL_BUSY if the
+ *         transfer is still running, HAL_TIMEOUT if it has been running for
+ *         longer than the read timeout, HAL_ERROR if it failed or none was started
+ * @note Consuming the sample (or the error) returns the state to idle. The
+ *       frame is converted and checked for auto-ranging here, in the
+ *       caller's context, not in the completion interrupt. A timed out
+ *       transfer is aborted through the transport abort hook so the
+ *       peripheral is free again; a late completion is ignored.
+ */
+HAL_StatusTypeDef MPU6500_GetAsyncSample(MPU6500_Handle *hmpu, MPU6500_Sample *sample);
+
+/**
+ * @brief Completion hook for non-blocking transfers on any transport
+ * @param hmpu Pointer to the MPU6500 handle
+ * @note Call this from the bus completion interrupt of a custom transport.
+ *       It only chains the next step or marks the frame ready; conversion
+ *       and auto-range state stay with MPU6500_GetAsyncSample.
+ */
+void MPU6500_AsyncCpltCallback(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Error hook for non-blocking transfers on any transport
+ * @param hmpu Pointer to the MPU6500 handle
+ * @note Call this from the bus error interrupt of a custom transport.
+ *       A step the transport reports as NACKed is retried up to
+ *       MPU6500_ASYNC_MAX_RETRIES times.
+ */
+void MPU6500_AsyncErrorCallback(MPU6500_Handle *hmpu);
+
+#ifdef HAL_I2C_MODULE_ENABLED
+/**
+ * @brief Completion hook for non-blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param hi2c I2C handle passed to HAL_I2C_MemRxCpltCallback
+ * @note Call this from HAL_I2C_MemRxCpltCallback. Ignored unless hi2c
+ *       belongs to the active transport.
+ */
+void MPU6500_I2C_MemRxCpltCallback(MPU6500_Handle *hmpu, I2C_HandleTypeDef *hi2c);
+
+/**
+ * @brief Error hook for non-blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param hi2c I2C handle passed to HAL_I2C_ErrorCallback
+ * @note Call this from HAL_I2C_ErrorCallback.
+ */
+void MPU6500_I2C_ErrorCallback(MPU6500_Handle *hmpu, I2C_HandleTypeDef *hi2c);
+#endif
+
+#ifdef HAL_SPI_MODULE_ENABLED
+/**
+ * @brief Completion hook for non-blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param hspi SPI handle passed to HAL_SPI_RxCpltCallback
+ * @note Call this from HAL_SPI_RxCpltCallback. Ignored unless hspi
+ *       belongs to the active transport.
+ */
+void MPU6500_SPI_RxCpltCallback(MPU6500_Handle *hmpu, SPI_HandleTypeDef *hspi);
+
+/**
+ * @brief Error hook for non-blocking transfers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param hspi SPI handle passed to HAL_SPI_ErrorCallback
+ * @note Call this from HAL_SPI_ErrorCallback.
+ */
+void MPU6500_SPI_ErrorCallback(MPU6500_Handle *hmpu, SPI_HandleTypeDef *hspi);
+#endif
+
+/**
+ * @brief Start streaming samples into the hardware FIFO
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param channels MPU6500_FIFO_ACCEL, MPU6500_FIFO_TEMP and/or MPU6500_FIFO_GYRO
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note The FIFO is reset first. One frame is written per sample (at the
+ *       rate set by SMPLRT_DIV) holding the selected channels in register
+ *       order: accel X/Y/Z, temp, gyro X/Y/Z, each big-endian int16.
+ *       FIFO_OFLOW_EN is set so an overflow also asserts the INT pin.
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Enable(MPU6500_Handle *hmpu, uint8_t channels);
+
+/**
+ * @brief Stop streaming samples into the hardware FIFO
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Disable(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Discard the FIFO contents
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Reset(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Read the number of bytes waiting in the FIFO
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param count Pointer to store the byte count
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ */
+HAL_StatusTypeDef MPU6500_FIFO_GetCount(MPU6500_Handle *hmpu, uint16_t *count);
+
+/**
+ * @brief Drain whole frames from the FIFO in one burst read
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param buffer Buffer for the raw frames, max_frames * frame size bytes
+ * @param max_frames Capacity of buffer in frames
+ * @param batch Pointer to store the number of frames read and resync events
+ * @return HAL_StatusTypeDef HAL_OK on success (also with 0 frames), error on failure
+ * @note Two transfers: FIFO_COUNT, then FIFO_R_W for all complete frames
+ *       that fit. A partially written frame stays in the FIFO.
+ * @note When the FIFO overflowed (it is full, or FIFO_OFLOW was seen in
+ *       INT_STATUS by MPU6500_ReadRawAllWithStatus) or a previous FIFO_R_W
+ *       read broke off, frame boundaries are unknown. The FIFO is then reset
+ *       through FIFO_RST instead of being read, and the batch reports
+ *       resync = 1 with no frames and the estimated number of lost samples
+ *       (frames left behind plus samples produced since the last drain).
+ *       Frames of the next batch start on a frame boundary again.
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Read(MPU6500_Handle *hmpu, uint8_t *buffer, uint16_t max_frames, MPU6500_FIFO_Batch *batch);
+
+/**
+ * @brief Decode raw FIFO frames into per-channel int16 arrays
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param buffer Frames read by MPU6500_FIFO_Read
+ * @param frames Number of frames in buffer
+ * @param out Destination arrays
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if streaming is off
+ * @note The frame layout follows the channels passed to MPU6500_FIFO_Enable.
+ *       Offsets are not applied. Byte swapping uses SSE2 when the compiler
+ *       targets it, REV16 on Cortex-M3/M4/M7/M33, plain C otherwise.
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Decode(MPU6500_Handle *hmpu, const uint8_t *buffer, uint16_t frames, const MPU6500_RawChannels *out);
+
+/**
+ * @brief Decode raw FIFO frames into per-channel arrays in physical units
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param buffer Frames read by MPU6500_FIFO_Read
+ * @param frames Number of frames in buffer
+ * @param out Destination arrays
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if streaming is off
+ * @note Offsets are applied, as in MPU6500_ReadAll.
+ */
+HAL_StatusTypeDef MPU6500_FIFO_DecodeFloat(MPU6500_Handle *hmpu, const uint8_t *buffer, uint16_t frames, const MPU6500_Channels *out);
+
+/**
+ * @brief Convert a block of raw X/Y/Z triplets to float
+ * @param raw Interleaved raw triplets (X0 Y0 Z0 X1 ...)
+ * @param count Number of triplets
+ * @param offset Per-axis offsets subtracted before scaling (raw LSB)
+ * @param scale Output units per LSB
+ * @param out Interleaved destination, 3 * count floats
+ * @note out = (int16_t)(raw - offset) * scale, bit-identical to the single
+ *       sample reads. Uses AVX2 or SSE2 when the compiler targets them
+ *       (24 values per iteration), a hoisted scalar loop otherwise,
+ *       which the Cortex-M4/M7 FPU turns into VCVT + VMUL per value.
+ *       No alignment is required. Build host tools with -mavx2 or
+ *       -march=native to get the widest kernel.
+ */
+void MPU6500_ConvertBatch(const int16_t *raw, uint32_t count, const int16_t offset[3], float scale, float *out);
+
+/**
+ * @brief Convert logged raw accelerometer triplets to m/s²
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param raw Interleaved raw triplets
+ * @param count Number of triplets
+ * @param out Interleaved destination, 3 * count floats
+ * @note Uses the active range and offsets of the handle. For logs that
+ *       span range switches, call MPU6500_ConvertBatch per segment with
+ *       MPU6500_GRAVITY / MPU6500_ACCEL_SENS_xxx.
+ */
+void MPU6500_ConvertAccelBatch(MPU6500_Handle *hmpu, const int16_t *raw, uint32_t count, float *out);
+
+/**
+ * @brief Convert logged raw gyroscope triplets to rad/s
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param raw Interleaved raw triplets
+ * @param count Number of triplets
+ * @param out Interleaved destination, 3 * count floats
+ * @note Uses the active range and offsets of the handle, see
+ *       MPU6500_ConvertAccelBatch.
+ */
+void MPU6500_ConvertGyroBatch(MPU6500_Handle *hmpu, const int16_t *raw, uint32_t count, float *out);
+
+/**
+ * @brief Set the time source used to timestamp FIFO batches
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param clock_us Function returning a free running time in µs, NULL for HAL_GetTick
+ * @note Use a hardware timer: with HAL_GetTick the timestamps only become
+ *       accurate to about a millisecond after smoothing.
+ */
+void MPU6500_SetClock(MPU6500_Handle *hmpu, uint64_t (*clock_us)(void));
+
+/**
+ * @brief Assign a sample time to every frame of a FIFO batch
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param batch Batch returned by MPU6500_FIFO_Read
+ * @param timestamps Array for batch->frames timestamps in µs
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if streaming is off
+ * @note Frames are spaced by the sample period of the configured output
+ *       data rate (SMPLRT_DIV and DLPF), corrected for oscillator drift. Each drain bounds the newest frame
+ *       in the FIFO (backlog included) to no later than batch->time_us.
+ *       An estimate past that bound is pulled back at once; an estimate
+ *       that is early moves 1 / 2^MPU6500_TS_SMOOTH_SHIFT of the way per
+ *       drain. Late drains therefore cause no jitter, and the timestamps
+ *       follow the earliest observed drain latency. Call it for every batch,
+ *       in order; a resync restarts the estimate. Frames are spaced by
+ *       the measured period (see MPU6500_GetSamplePeriod).
+ */
+HAL_StatusTypeDef MPU6500_FIFO_Timestamp(MPU6500_Handle *hmpu, const MPU6500_FIFO_Batch *batch, uint64_t *timestamps);
+
+/**
+ * @brief Get the measured sample period
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return float Time between two samples in seconds, for integration and resampling
+ * @note Starts at the nominal period of the configured ODR and follows the
+ *       sensor oscillator (±1% over temperature) once FIFO batches are
+ *       timestamped: the phase corrections of MPU6500_FIFO_Timestamp are
+ *       averaged over MPU6500_DRIFT_WINDOW samples and half of the implied
+ *       period error is applied per window.
+ */
+float MPU6500_GetSamplePeriod(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Get the sensor clock drift relative to the MCU time source
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return int32_t Deviation of the measured from the nominal period in ppm
+ *         (positive: the sensor runs slow)
+ */
+int32_t MPU6500_GetClockDrift(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Get the data rate the FIFO produces
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return uint32_t Bytes per second the drains must sustain, 0 if streaming is off
+ */
+uint32_t MPU6500_FIFO_GetDataRate(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Get the size of one FIFO frame
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return uint8_t Bytes per frame, 0 if streaming is off
+ */
+uint8_t MPU6500_FIFO_GetFrameSize(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Switch the accelerometer and gyroscope full scale ranges
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param accel_fs MPU6500_ACCEL_FS_xxx
+ * @param gyro_fs MPU6500_GYRO_FS_xxx
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Both ranges go out in one burst write (GYRO_CONFIG and
+ *       ACCEL_CONFIG are adjacent); the filter bypass bits are kept.
+ *       On success the cached reciprocal scale factors are swapped so
+ *       every conversion stays one multiply per axis, and calibration
+ *       offsets are rescaled to the new LSB size. Samples already
+ *       latched in the data registers were taken at the old range; the
+ *       next converted sample is flagged settling. While streaming, a
+ *       range change discards the FIFO: the next MPU6500_FIFO_Read()
+ *       resets it and reports the dropped frames as resync/lost, so no
+ *       frame is decoded with the wrong scale. Decode batches already
+ *       read before calling this.
+ */
+HAL_StatusTypeDef MPU6500_SetFullScale(MPU6500_Handle *hmpu, uint8_t accel_fs, uint8_t gyro_fs);
+
+/**
+ * @brief Enable automatic full scale switching
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sensors MPU6500_AUTORANGE_xxx, MPU6500_AUTORANGE_OFF to disable
+ * @note Every converted sample is checked with a few integer compares.
+ *       A raw value at or above MPU6500_AUTORANGE_HIGH steps the range up
+ *       at once; MPU6500_AUTORANGE_HOLD consecutive samples with all axes
+ *       below MPU6500_AUTORANGE_LOW step it back down. The gap between the
+ *       two thresholds is the hysteresis that keeps the range from toggling.
+ *       MPU6500_ReadAll, MPU6500_ReadAllWithStatus and MPU6500_GetAsyncSample
+ *       write the new range after conversion; MPU6500_ReadAllWithin only
+ *       if its budget still covers the write, else it stays pending.
+ *       Each MPU6500_Sample carries the range it was converted with. The
+ *       sample after a switch is flagged settling since the data registers
+ *       may still hold a frame taken at the old range, and is converted and
+ *       tagged with the old range and offsets. Pace reads by data-ready for
+ *       this to hold. FIFO frames are not auto-ranged and carry no range
+ *       tag; a switch while streaming drops the queued frames (see
+ *       MPU6500_SetFullScale).
+ */
+void MPU6500_SetAutoRange(MPU6500_Handle *hmpu, uint8_t sensors);
+
+/**
+ * @brief Select the low pass filters and the output data rate
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param gyro_dlpf MPU6500_GYRO_DLPF_xxx
+ * @param accel_dlpf MPU6500_ACCEL_DLPF_xxx
+ * @param smplrt_div Sample rate divider: ODR = 1 kHz / (1 + smplrt_div)
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note Written in one burst (SMPLRT_DIV..ACCEL_CONFIG_2), registers that
+ *       keep their value are not rewritten. With MPU6500_GYRO_DLPF_250HZ or
+ *       _3600HZ the gyro runs at 8 kHz and smplrt_div is ignored; the
+ *       accelerometer never updates faster than 1 kHz. Lower bandwidth means
+ *       less noise but more group delay, see MPU6500_GetGyroFilterInfo.
+ */
+HAL_StatusTypeDef MPU6500_SetDataRate(MPU6500_Handle *hmpu, uint8_t gyro_dlpf, uint8_t accel_dlpf, uint8_t smplrt_div);
+
+/**
+ * @brief Bypass the low pass filters for raw high-bandwidth data
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param gyro_bypass MPU6500_GYRO_BYPASS_xxx
+ * @param accel_bypass MPU6500_ACCEL_BYPASS_xxx
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note With a gyro bypass the data registers and the FIFO update at
+ *       32 kHz and SMPLRT_DIV is ignored; the accelerometer delivers its
+ *       newest sample (4 kHz with the accel bypass, else 1 kHz) in each
+ *       frame. Only the FIFO drained over SPI keeps up with these rates:
+ *
+ *       | ODR    | FIFO frame      | Data rate | Drain before  | Transport        |
+ *       |--------|-----------------|-----------|---------------|------------------|
+ *       | 1 kHz  | accel+gyro 12 B | 12 kB/s   | 42 ms         | I2C 400 kHz, SPI |
+ *       | 8 kHz  | gyro 6 B        | 48 kB/s   | 10 ms         | SPI >= 1 MHz     |
+ *       | 8 kHz  | accel+gyro 12 B | 96 kB/s   | 5 ms          | SPI fast reads   |
+ *       | 32 kHz | gyro 6 B        | 192 kB/s  | 2.6 ms        | SPI fast reads   |
+ *       | 32 kHz | accel+gyro 12 B | 384 kB/s  | 1.3 ms        | SPI fast reads   |
+ *
+ *       I2C at 400 kHz moves about 40 kB/s; it cannot follow any bypass
+ *       mode without dropping samples. "SPI fast reads" needs dual_speed
+ *       in MPU6500_SPI_Bus (up to 20 MHz, about 2 MB/s). Pass the
+ *       _OFF values to return to the filtered modes of MPU6500_SetDataRate.
+ */
+HAL_StatusTypeDef MPU6500_SetHighRateMode(MPU6500_Handle *hmpu, uint8_t gyro_bypass, uint8_t accel_bypass);
+
+/**
+ * @brief Get the nominal output data rate of the current configuration
+ * @param hmpu Pointer to the MPU6500 handle
+ * @return float Samples per second written to the data registers and the FIFO
+ */
+float MPU6500_GetOutputDataRate(MPU6500_Handle *hmpu);
+
+/**
+ * @brief Look up bandwidth, group delay and sample rate of a gyro filter setting
+ * @param dlpf MPU6500_GYRO_DLPF_xxx
+ * @return const MPU6500_FilterInfo* Filter characteristics, NULL if dlpf is invalid
+ */
+const MPU6500_FilterInfo *MPU6500_GetGyroFilterInfo(uint8_t dlpf);
+
+/**
+ * @brief Look up bandwidth, group delay and sample rate of an accel filter setting
+ * @param dlpf MPU6500_ACCEL_DLPF_xxx, or MPU6500_ACCEL_BYPASS_1130HZ for the 4 kHz bypass
+ * @return const MPU6500_FilterInfo* Filter characteristics, NULL if dlpf is invalid
+ */
+const MPU6500_FilterInfo *MPU6500_GetAccelFilterInfo(uint8_t dlpf);
 
 /**
  * @brief Put the MPU6500 into sleep mode to save power
+ * @param hmpu Pointer to the MPU6500 handle
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  * @note Sets SLEEP bit (bit 6) in PWR_MGMT_1 register
  */
-HAL_StatusTypeDef MPU6500_Sleep(void);
+HAL_StatusTypeDef MPU6500_Sleep(MPU6500_Handle *hmpu);
 
 /**
  * @brief Wake up the MPU6500 from sleep mode
+ * @param hmpu Pointer to the MPU6500 handle
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  * @note Clears SLEEP bit (bit 6) in PWR_MGMT_1 register
  */
-HAL_StatusTypeDef MPU6500_WakeUp(void);
+HAL_StatusTypeDef MPU6500_WakeUp(MPU6500_Handle *hmpu);
 
 /**
  * @brief Initialize and calibrate the offset of MPU6500
+ * @param hmpu Pointer to the MPU6500 handle
  * @param samples Number of samples to collect for calibration
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  * @note This function collects multiple samples, calculates the average
- *       offset, and writes the offset values to the appropriate registers.
- *       Make sure the sensor is stationary during calibration.
+ *       offset, and stores it in accel_offset / gyro_offset, which the read
+ *       functions subtract. Windows of MPU6500_CALIB_WINDOW samples that
+ *       exceed MPU6500_CALIB_ACCEL_NOISE_G / MPU6500_CALIB_GYRO_NOISE_DPS are
+ *       collected again; after MPU6500_CALIB_MAX_REJECTS of them HAL_ERROR
+ *       is returned and the offsets are left unchanged. Call MPU6500_ApplyHardwareOffsets to move it
+ *       into the sensor. Make sure the sensor is stationary during calibration.
+ *       Same as MPU6500_InitOffsetCalibrationEx without the result.
+ */
+HAL_StatusTypeDef MPU6500_InitOffsetCalibration(MPU6500_Handle *hmpu, uint32_t samples);
+
+/**
+ * @brief Calibrate the offsets from blocking reads and report the quality figures
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param samples Number of samples to collect for calibration
+ * @param result Pointer to store the sample count and quality figures, or NULL
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if more than
+ *         MPU6500_CALIB_MAX_REJECTS windows were rejected, error on failure
+ * @note Collects as MPU6500_InitOffsetCalibration. The result is filled in
+ *       on failure too, so a rejected run still reports the noise that
+ *       caused it; converged is always 0.
+ */
+HAL_StatusTypeDef MPU6500_InitOffsetCalibrationEx(MPU6500_Handle *hmpu, uint32_t samples, MPU6500_CalibResult *result);
+
+/**
+ * @brief Calibrate the offsets from FIFO bursts at the output data rate
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param config Parameters, NULL for the MPU6500_CALIB_xxx defaults
+ * @param result Pointer to store the sample count and quality figures, or NULL
+ * @return HAL_StatusTypeDef HAL_OK on success, HAL_ERROR if more than
+ *         max_rejects windows were rejected, HAL_TIMEOUT if the FIFO
+ *         stopped delivering, error on failure
+ * @note Same result as MPU6500_InitOffsetCalibration (sensor at rest, Z axis
+ *       up), but every sample of the configured ODR is used and each FIFO
+ *       drain is a single burst. After min_samples, collection stops as soon
+ *       as no mean moves by more than the tolerance from one batch to the
+ *       next. At most max_samples + (max_rejects + 1) * MPU6500_CALIB_WINDOW
+ *       samples are read, and a FIFO that stops delivering times out after
+ *       9/8 of that time. At 1 kHz the defaults converge in about
+ *       130-260 ms on a quiet sensor; no outcome takes longer than 384 ms
+ *       of samples, or 432 ms plus one batch (16 ms) to time out, so the
+ *       call returns within 500 ms. Lower output data rates scale these
+ *       times. Streaming is restarted with the previous FIFO channels afterwards
+ *       (or switched off), so buffered frames are dropped.
+ * @note Samples are checked in windows of MPU6500_CALIB_WINDOW. A window
+ *       whose variance on any axis exceeds the noise limit (a bump or a
+ *       vibration) is dropped and collected again. After max_rejects drops
+ *       the call fails fast and leaves the offsets untouched. Samples are
+ *       accumulated as 64-bit integer sums of raw LSB about the first
+ *       sample, so there is no floating point per sample (no soft double
+ *       on single-precision FPUs) and the offsets are exact rounded means;
+ *       the sums hold up to 10^9 samples. The result is filled in on
+ *       failure too.
+ */
+HAL_StatusTypeDef MPU6500_FastOffsetCalibration(MPU6500_Handle *hmpu, const MPU6500_CalibConfig *config, MPU6500_CalibResult *result);
+
+/**
+ * @brief Move the calibration offsets into the sensor's offset registers
+ * @param hmpu Pointer to the MPU6500 handle
+ * @param sensors MPU6500_OFFSET_xxx
+ * @return HAL_StatusTypeDef HAL_OK on success, error on failure
+ * @note The offsets in accel_offset / gyro_offset are converted to the
+ *       register formats and added to the values already in the registers
+ *       (the factory accel trim, or an earlier call), then cleared in the
+ *       handle. The sensor then outputs corrected data, FIFO frames included,
+ *       and the CPU no longer subtracts anything. Gyro offsets go out in one
+ *       6-byte write; accel offsets are rounded to the 0.98 mg step and the
+ *       reserved bit 0 is kept. The values are restored by MPU6500_CheckHealth
+ *       after a sensor reset; MPU6500_Init clears them.
  */
-HAL_StatusTypeDef MPU6500_InitOffsetCalibration(uint32_t samples);
+HAL_StatusTypeDef MPU6500_ApplyHardwareOffsets(MPU6500_Handle *hmpu, uint8_t sensors);
 
 /**
  * @brief 打印MPU6500的偏移校准值
+ * @param hmpu Pointer to the MPU6500 handle
  * @return HAL_StatusTypeDef HAL_OK on success, error on failure
  */
-extern HAL_StatusTypeDef MPU6500_PrintOffsets(void);
+extern HAL_StatusTypeDef MPU6500_PrintOffsets(MPU6500_Handle *hmpu);
 
 #ifdef __cplusplus
 }
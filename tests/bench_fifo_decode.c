@@ -0,0 +1,83 @@
+/**
+ * @file bench_fifo_decode.c
+ * @brief FIFO decode throughput: batch decoder vs a per-frame parse loop
+ * @note Fails only on a decoding mismatch, converted values must be
+ *       bit-identical to the per-frame path; the timings are informational.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include "mpu6500.h"
+#include "sim.h"
+#include <time.h>
+
+#define BENCH_FRAMES    36          // 504 bytes, a full FIFO of 14-byte frames
+#define BENCH_ROUNDS    20000
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+static uint8_t buffer[BENCH_FRAMES * 14];
+static int16_t raw[7][BENCH_FRAMES], ref_raw[7][BENCH_FRAMES];
+static float conv[7][BENCH_FRAMES], ref_conv[7][BENCH_FRAMES];
+
+static double now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Frame at a time, as an application would without the batch decoder */
+static void reference_decode(const uint8_t *frames, uint16_t count){
+    for(uint16_t f = 0; f < count; f++){
+        const uint8_t *p = frames + 14U * f;
+        for(int c = 0; c < 7; c++){
+            int16_t v = (int16_t)((p[2 * c] << 8) | p[2 * c + 1]);
+            float scale = (c < 3) ? hmpu.accel_scale : hmpu.gyro_scale;
+            int16_t offset = (c < 3) ? hmpu.accel_offset[c] : (c > 3) ? hmpu.gyro_offset[c - 4] : 0;
+            ref_raw[c][f] = v;
+            ref_conv[c][f] = (c == 3) ? (float)v / MPU6500_TEMP_SENS + MPU6500_TEMP_OFFSET
+                                      : (float)(int16_t)(v - offset) * scale;
+        }
+    }
+}
+
+int main(void){
+    const MPU6500_RawChannels raw_out = { { raw[0], raw[1], raw[2] }, raw[3], { raw[4], raw[5], raw[6] } };
+    const MPU6500_Channels conv_out = { { conv[0], conv[1], conv[2] }, conv[3], { conv[4], conv[5], conv[6] } };
+    double t0, t_ref, t_raw, t_conv;
+    uint32_t seed = 12345;
+    int r, c, f;
+
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    CHECK(MPU6500_FIFO_Enable(&hmpu, MPU6500_FIFO_ALL) == HAL_OK);
+    // Calibrated, with offsets large enough to wrap raw - offset at the ends
+    hmpu.accel_offset[0] = 1200; hmpu.accel_offset[1] = -850; hmpu.accel_offset[2] = 33;
+    hmpu.gyro_offset[0] = -7; hmpu.gyro_offset[1] = 2900; hmpu.gyro_offset[2] = -32000;
+    for(f = 0; f < (int)sizeof(buffer); f++){
+        seed = seed * 1103515245U + 12345U;
+        buffer[f] = (uint8_t)(seed >> 16);
+    }
+
+    t0 = now_ns();
+    for(r = 0; r < BENCH_ROUNDS; r++) reference_decode(buffer, BENCH_FRAMES);
+    t_ref = now_ns() - t0;
+    t0 = now_ns();
+    for(r = 0; r < BENCH_ROUNDS; r++) CHECK(MPU6500_FIFO_Decode(&hmpu, buffer, BENCH_FRAMES, &raw_out) == HAL_OK);
+    t_raw = now_ns() - t0;
+    t0 = now_ns();
+    for(r = 0; r < BENCH_ROUNDS; r++) CHECK(MPU6500_FIFO_DecodeFloat(&hmpu, buffer, BENCH_FRAMES, &conv_out) == HAL_OK);
+    t_conv = now_ns() - t0;
+
+    for(c = 0; c < 7; c++){
+        for(f = 0; f < BENCH_FRAMES; f++){
+            CHECK(raw[c][f] == ref_raw[c][f]);
+            CHECK(conv[c][f] == ref_conv[c][f]);
+        }
+    }
+    printf("per-frame parse + convert   %6.1f ns/frame\n", t_ref / ((double)BENCH_ROUNDS * BENCH_FRAMES));
+    printf("MPU6500_FIFO_Decode         %6.1f ns/frame\n", t_raw / ((double)BENCH_ROUNDS * BENCH_FRAMES));
+    printf("MPU6500_FIFO_DecodeFloat    %6.1f ns/frame\n", t_conv / ((double)BENCH_ROUNDS * BENCH_FRAMES));
+    return sim_failures != 0;
+}
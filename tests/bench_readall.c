@@ -0,0 +1,72 @@
+/**
+ * @file bench_readall.c
+ * @brief Bus traffic per sample: ReadAccel + ReadGyro + ReadTemp vs ReadAll
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+
+#define BENCH_SAMPLES   1000
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+typedef struct {
+    uint32_t xfers;
+    uint32_t bytes;
+    uint64_t us;
+} BenchResult;
+
+static void bench_start(BenchResult *r){
+    r->xfers = sim.xfers;
+    r->bytes = sim.bus_bytes;
+    r->us = sim_time_us();
+}
+
+static void bench_stop(BenchResult *r, const char *name){
+    r->xfers = sim.xfers - r->xfers;
+    r->bytes = sim.bus_bytes - r->bytes;
+    r->us = sim_time_us() - r->us;
+    printf("%-28s %5.2f transfers  %5.1f bytes  %6.1f us per sample\n", name,
+           (double)r->xfers / BENCH_SAMPLES, (double)r->bytes / BENCH_SAMPLES, (double)r->us / BENCH_SAMPLES);
+}
+
+int main(void){
+    static const int16_t accel[3] = { 100, -200, 2048 };
+    static const int16_t gyro[3] = { 5, -5, 0 };
+    BenchResult separate, burst;
+    MPU6500_Sample sample;
+    float ax, ay, az, gx, gy, gz;
+    int16_t temp;
+    int i;
+
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    sim_set_sample(accel, 0, gyro);
+
+    bench_start(&separate);
+    for(i = 0; i < BENCH_SAMPLES; i++){
+        CHECK(MPU6500_ReadAccel(&hmpu, &ax, &ay, &az) == HAL_OK);
+        CHECK(MPU6500_ReadGyro(&hmpu, &gx, &gy, &gz) == HAL_OK);
+        CHECK(MPU6500_ReadTemp(&hmpu, &temp) == HAL_OK);
+    }
+    bench_stop(&separate, "ReadAccel+ReadGyro+ReadTemp");
+
+    bench_start(&burst);
+    for(i = 0; i < BENCH_SAMPLES; i++){
+        CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    }
+    bench_stop(&burst, "ReadAll");
+
+    // Same data either way
+    CHECK(sample.accel[0] == ax && sample.accel[1] == ay && sample.accel[2] == az);
+    CHECK(sample.gyro[0] == gx && sample.gyro[1] == gy && sample.gyro[2] == gz);
+
+    // One 14-byte transfer (17 bytes with addressing) instead of three (23 bytes)
+    CHECK(burst.xfers == BENCH_SAMPLES);
+    CHECK(burst.bytes == BENCH_SAMPLES * 17U);
+    CHECK(separate.bytes == BENCH_SAMPLES * 23U);
+    CHECK(burst.us < separate.us);
+    return sim_failures != 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file check_fixed.c
+ * @brief Exhaustive error bound of the fixed-point read paths
+ * @note Every raw value of every range, in both formats, is converted by
+ *       MPU6500_ReadAllFixed and compared against the exact result. Fails if
+ *       an error exceeds the bound documented in mpu6500.h.
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+#include <math.h>
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+static const uint8_t accel_fs[4] = { MPU6500_ACCEL_FS_2G, MPU6500_ACCEL_FS_4G, MPU6500_ACCEL_FS_8G, MPU6500_ACCEL_FS_16G };
+static const uint8_t gyro_fs[4] = { MPU6500_GYRO_FS_250DPS, MPU6500_GYRO_FS_500DPS, MPU6500_GYRO_FS_1000DPS, MPU6500_GYRO_FS_2000DPS };
+static const double accel_sens[4] = { 16384.0, 8192.0, 4096.0, 2048.0 };
+static const double gyro_sens[4] = { 131.0, 65.5, 32.8, 16.4 };
+static const double unit[2] = { 65536.0, 1000.0 };
+static const char *const name[2] = { "Q16.16", "milli" };
+
+int main(void){
+    double accel_err[2] = { 0 }, gyro_err[2] = { 0 }, temp_err[2] = { 0 };
+    MPU6500_FixedSample fixed;
+    int format, r;
+    int32_t v;
+
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+
+    for(r = 0; r < 4; r++){
+        CHECK(MPU6500_SetFullScale(&hmpu, accel_fs[r], gyro_fs[r]) == HAL_OK);
+        CHECK(MPU6500_ReadAllFixed(&hmpu, MPU6500_FIXED_Q16, &fixed) == HAL_OK);   // Settling sample
+        for(v = -32768; v <= 32767; v++){
+            const int16_t raw[3] = { (int16_t)v, 0, 0 };
+            sim_set_sample(raw, (int16_t)v, raw);
+            for(format = MPU6500_FIXED_Q16; format <= MPU6500_FIXED_MILLI; format++){
+                double err;
+                CHECK(MPU6500_ReadAllFixed(&hmpu, (uint8_t)format, &fixed) == HAL_OK);
+                err = fabs(fixed.accel[0] - v * unit[format] / accel_sens[r]);
+                if(err > accel_err[format]) accel_err[format] = err;
+                err = fabs(fixed.gyro[0] - v * unit[format] / gyro_sens[r]);
+                if(err > gyro_err[format]) gyro_err[format] = err;
+                err = fabs(fixed.temp - (v / 333.87 + MPU6500_TEMP_OFFSET) * unit[format]);
+                if(err > temp_err[format]) temp_err[format] = err;
+            }
+        }
+    }
+
+    for(format = 0; format < 2; format++){
+        printf("%-7s max error: accel %.3f, gyro %.3f, temp %.3f LSB\n",
+               name[format], accel_err[format], gyro_err[format], temp_err[format]);
+        CHECK(accel_err[format] <= 0.5);
+        CHECK(gyro_err[format] <= 0.75);
+        CHECK(temp_err[format] <= 0.75);
+    }
+    return sim_failures != 0;
+}
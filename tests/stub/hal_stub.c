@@ -0,0 +1,506 @@
+/**
+ * @file hal_stub.c
+ * @brief Stub STM32 HAL driving a simulated MPU6500 on a simulated clock
+ * @details Blocking transfers advance the clock by their bus time and return
+ *          immediately. Non-blocking transfers are queued and complete from
+ *          sim_advance_us(), calling the HAL callbacks like the IRQ handlers
+ *          of a real part would. Faults are injected through the sim state.
+ */
+
+#include "sim.h"
+#include <string.h>
+
+/* Registers with side effects */
+#define SIM_FIFO_EN         0x23
+#define SIM_INT_STATUS      0x3A
+#define SIM_USER_CTRL       0x6A
+#define SIM_PWR_MGMT_1      0x6B
+#define SIM_FIFO_COUNT_H    0x72
+#define SIM_FIFO_COUNT_L    0x73
+#define SIM_FIFO_R_W        0x74
+#define SIM_WHO_AM_I        0x75
+
+#define SIM_FIFO_SIZE       512
+#define SIM_BUSY_TIMEOUT_MS 25      // I2C_TIMEOUT_BUSY_FLAG of the HAL
+#define SIM_NEVER           UINT64_MAX
+
+SimState sim;
+int sim_failures;
+
+I2C_HandleTypeDef hi2c1;
+SPI_HandleTypeDef hspi1;
+GPIO_TypeDef sim_gpioa, sim_gpiob;
+
+static SPI_TypeDef spi1_regs;
+static uint64_t now_ns;
+static uint64_t sample_due_ns;      // Next tick of the sensor clock
+
+/* Hardware FIFO ring buffer */
+static uint8_t fifo[SIM_FIFO_SIZE];
+static uint16_t fifo_head, fifo_count;
+
+/* Non-blocking transfer in flight, one at a time */
+static struct {
+    int active;
+    int spi;                // 1: SPI, 0: I2C
+    int nack;               // Completes with an error
+    uint64_t done_ns;
+    uint8_t reg;
+    uint8_t *data;
+    uint16_t len;
+} pending;
+
+/* SPI frame state, driven by chip select */
+static struct {
+    int selected;
+    int addressed;          // Address byte of this frame seen
+    int read;
+    uint8_t reg;
+} spi;
+
+static uint8_t scl_level = 1;
+
+static void sim_power_on(void){
+    memset(sim.regs, 0, sizeof(sim.regs));
+    sim.regs[SIM_PWR_MGMT_1] = 0x40;    // SLEEP
+    sim.regs[SIM_WHO_AM_I] = 0x70;
+    fifo_head = 0;
+    fifo_count = 0;
+}
+
+void sim_reset(void){
+    memset(&sim, 0, sizeof(sim));
+    memset(&pending, 0, sizeof(pending));
+    memset(&spi, 0, sizeof(spi));
+    sim.i2c_hz = 400000;
+    sim.spi_hz = 1000000;
+    sim_power_on();
+    now_ns = 0;
+    sample_due_ns = 0;
+    scl_level = 1;
+    hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
+    spi1_regs.CR1 = 0;
+    hspi1.Instance = &spi1_regs;
+    hspi1.Init.BaudRatePrescaler = 0;
+    hspi1.ErrorCode = HAL_SPI_ERROR_NONE;
+}
+
+void sim_power_cycle(void){
+    sim_power_on();
+}
+
+uint64_t sim_time_us(void){
+    return now_ns / 1000U;
+}
+
+int sim_busy(void){
+    return pending.active;
+}
+
+void sim_set_sample(const int16_t accel[3], int16_t temp, const int16_t gyro[3]){
+    const int16_t words[7] = { accel[0], accel[1], accel[2], temp, gyro[0], gyro[1], gyro[2] };
+    for(int i = 0; i < 7; i++){
+        sim.regs[0x3B + 2 * i] = (uint8_t)((uint16_t)words[i] >> 8);
+        sim.regs[0x3C + 2 * i] = (uint8_t)words[i];
+    }
+}
+
+void sim_fifo_push(const uint8_t *data, uint16_t len){
+    for(uint16_t i = 0; i < len; i++){
+        if(fifo_count == SIM_FIFO_SIZE){
+            // Full: the oldest byte is overwritten
+            fifo_head = (uint16_t)((fifo_head + 1) % SIM_FIFO_SIZE);
+            fifo_count--;
+            sim.regs[SIM_INT_STATUS] |= 0x10;   // FIFO_OFLOW_INT
+        }
+        fifo[(fifo_head + fifo_count) % SIM_FIFO_SIZE] = data[i];
+        fifo_count++;
+    }
+}
+
+uint16_t sim_fifo_count(void){
+    return fifo_count;
+}
+
+static uint8_t sim_read_reg(uint8_t reg){
+    uint8_t value;
+
+    reg &= 0x7F;
+    switch(reg){
+    case SIM_FIFO_COUNT_H:
+        return (uint8_t)(fifo_count >> 8);
+    case SIM_FIFO_COUNT_L:
+        return (uint8_t)fifo_count;
+    case SIM_FIFO_R_W:
+        if(fifo_count == 0) return 0xFF;
+        value = fifo[fifo_head];
+        fifo_head = (uint16_t)((fifo_head + 1) % SIM_FIFO_SIZE);
+        fifo_count--;
+        return value;
+    case SIM_INT_STATUS:
+        value = sim.regs[reg];
+        sim.regs[reg] = 0;                      // INT_ANYRD_2CLEAR
+        return value;
+    default:
+        return sim.regs[reg];
+    }
+}
+
+static void sim_write_reg(uint8_t reg, uint8_t value){
+    reg &= 0x7F;
+    switch(reg){
+    case SIM_PWR_MGMT_1:
+        if(value & 0x80){                       // DEVICE_RESET
+            sim.resets++;
+            sim_power_on();
+            return;
+        }
+        sim.regs[reg] = value;
+        return;
+    case SIM_USER_CTRL:
+        if(value & 0x04){                       // FIFO_RST, self-clearing
+            fifo_head = 0;
+            fifo_count = 0;
+        }
+        sim.regs[reg] = value & (uint8_t)~0x07;
+        return;
+    case SIM_FIFO_R_W:
+        sim_fifo_push(&value, 1);
+        return;
+    default:
+        sim.regs[reg] = value;
+        return;
+    }
+}
+
+/* FIFO_R_W does not auto-increment, every other register does */
+static void sim_read_burst(uint8_t reg, uint8_t *data, uint16_t len){
+    if(sim.sensor != NULL) sim.sensor();
+    for(uint16_t i = 0; i < len; i++){
+        data[i] = sim_read_reg(reg);
+        if(reg != SIM_FIFO_R_W) reg++;
+    }
+}
+
+static uint64_t sim_i2c_ns(uint32_t bits){
+    return (uint64_t)bits * 1000000000U / sim.i2c_hz;
+}
+
+static uint64_t sim_spi_ns(uint32_t bytes){
+    return (uint64_t)bytes * 8U * 1000000000U / sim.spi_hz;
+}
+
+static void sim_complete(void){
+    pending.active = 0;
+    if(pending.spi){
+        if(pending.nack){
+            hspi1.ErrorCode = HAL_SPI_ERROR_OVR;
+            HAL_SPI_ErrorCallback(&hspi1);
+            return;
+        }
+        sim_read_burst(pending.reg, pending.data, pending.len);
+        spi.reg = (uint8_t)(pending.reg + pending.len);
+        HAL_SPI_RxCpltCallback(&hspi1);
+        return;
+    }
+    if(pending.nack){
+        hi2c1.ErrorCode = HAL_I2C_ERROR_AF;
+        HAL_I2C_ErrorCallback(&hi2c1);
+        return;
+    }
+    sim_read_burst(pending.reg, pending.data, pending.len);
+    HAL_I2C_MemRxCpltCallback(&hi2c1);
+}
+
+/* One tick of the sensor clock: take a sample, queue the FIFO_EN channels in register order */
+static void sim_sample(void){
+    static const struct { uint8_t bit, reg, len; } channels[] = {
+        { 0x08, 0x3B, 6 }, { 0x80, 0x41, 2 }, { 0x40, 0x43, 2 }, { 0x20, 0x45, 2 }, { 0x10, 0x47, 2 },
+    };
+
+    if(sim.sample != NULL) sim.sample();
+    sim.samples++;
+    if(!(sim.regs[SIM_USER_CTRL] & 0x40)) return;
+    for(unsigned i = 0; i < sizeof(channels) / sizeof(channels[0]); i++){
+        if(sim.regs[SIM_FIFO_EN] & channels[i].bit) sim_fifo_push(&sim.regs[channels[i].reg], channels[i].len);
+    }
+}
+
+static void sim_advance_ns(uint64_t ns){
+    uint64_t target = now_ns + ns, xfer_ns, sample_ns;
+
+    // The sensor clock starts when sample_ns is first set
+    if(sim.sample_ns != 0 && sample_due_ns <= now_ns) sample_due_ns = now_ns + sim.sample_ns;
+    // Callbacks may chain the next transfer, which may end before target too
+    for(;;){
+        xfer_ns = pending.active ? pending.done_ns : SIM_NEVER;
+        sample_ns = (sim.sample_ns != 0) ? sample_due_ns : SIM_NEVER;
+        if(xfer_ns > target && sample_ns > target) break;
+        if(sample_ns < xfer_ns){
+            now_ns = sample_ns;
+            sample_due_ns += sim.sample_ns;
+            sim_sample();
+        } else {
+            now_ns = xfer_ns;
+            sim_complete();
+        }
+    }
+    now_ns = target;
+}
+
+void sim_advance_us(uint32_t us){
+    sim_advance_ns((uint64_t)us * 1000U);
+}
+
+/**
+ * @brief Common checks of an I2C transfer before its data phase
+ * @return HAL_StatusTypeDef HAL_OK to go on, otherwise the status to return
+ */
+static HAL_StatusTypeDef sim_i2c_start(uint32_t timeout, uint8_t blocking){
+    if(pending.active) return HAL_BUSY;             // Peripheral state is not READY
+    if(sim.stuck_sda != 0){
+        // BUSY flag never clears: the HAL gives up after I2C_TIMEOUT_BUSY_FLAG
+        if(blocking) sim_advance_ns((uint64_t)SIM_BUSY_TIMEOUT_MS * 1000000U);
+        return HAL_BUSY;
+    }
+    sim.xfers++;
+    if(blocking && sim.nack != 0){
+        sim.nack--;
+        sim.bus_bytes += 1;
+        sim_advance_ns(sim_i2c_ns(9 + 2));
+        hi2c1.ErrorCode = HAL_I2C_ERROR_AF;
+        return HAL_ERROR;
+    }
+    if(blocking && sim.stall != 0){
+        sim.stall--;
+        sim_advance_ns((uint64_t)timeout * 1000000U);
+        hi2c1.ErrorCode = HAL_I2C_ERROR_TIMEOUT;
+        return HAL_TIMEOUT;
+    }
+    hi2c1.ErrorCode = HAL_I2C_ERROR_NONE;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c){
+    (void)hi2c;
+    sim.inits++;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c){
+    (void)hi2c;
+    if(pending.active && !pending.spi) pending.active = 0;     // Transfer is dropped
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+    HAL_StatusTypeDef status;
+    (void)hi2c;
+    (void)DevAddress;
+    (void)MemAddSize;
+
+    status = sim_i2c_start(Timeout, 1);
+    if(status != HAL_OK) return status;
+    sim.bus_bytes += 2U + Size;
+    sim_advance_ns(sim_i2c_ns(9U * (2U + Size) + 2U));
+    for(uint16_t i = 0; i < Size; i++) sim_write_reg((uint8_t)(MemAddress + i), pData[i]);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+    HAL_StatusTypeDef status;
+    (void)hi2c;
+    (void)DevAddress;
+    (void)MemAddSize;
+
+    status = sim_i2c_start(Timeout, 1);
+    if(status != HAL_OK) return status;
+    sim.bus_bytes += 3U + Size;
+    sim_advance_ns(sim_i2c_ns(9U * (3U + Size) + 3U));
+    sim_read_burst((uint8_t)MemAddress, pData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size){
+    HAL_StatusTypeDef status;
+    (void)hi2c;
+    (void)DevAddress;
+    (void)MemAddSize;
+
+    status = sim_i2c_start(0, 0);
+    if(status != HAL_OK) return status;
+    pending.active = 1;
+    pending.spi = 0;
+    pending.reg = (uint8_t)MemAddress;
+    pending.data = pData;
+    pending.len = Size;
+    pending.nack = 0;
+    if(sim.stall != 0){
+        sim.stall--;
+        pending.done_ns = SIM_NEVER;
+    } else if(sim.nack != 0){
+        sim.nack--;
+        pending.nack = 1;
+        sim.bus_bytes += 1;
+        pending.done_ns = now_ns + sim_i2c_ns(9 + 2);
+    } else {
+        sim.bus_bytes += 3U + Size;
+        pending.done_ns = now_ns + sim_i2c_ns(9U * (3U + Size) + 3U);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size){
+    return HAL_I2C_Mem_Read_DMA(hi2c, DevAddress, MemAddress, MemAddSize, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress){
+    (void)hi2c;
+    (void)DevAddress;
+    if(!pending.active || pending.spi) return HAL_ERROR;
+    pending.active = 0;
+    sim.aborts++;
+    return HAL_OK;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c){
+    return hi2c->ErrorCode;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c){
+    (void)hi2c;
+    return (pending.active && !pending.spi) ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_READY;
+}
+
+__attribute__((weak)) void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    (void)hi2c;
+}
+
+__attribute__((weak)) void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    (void)hi2c;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+    uint16_t i = 0;
+    (void)Timeout;
+
+    if(pending.active) return HAL_BUSY;
+    if(!spi.selected || Size == 0) return HAL_ERROR;
+    hspi->ErrorCode = HAL_SPI_ERROR_NONE;
+    sim.bus_bytes += Size;
+    sim_advance_ns(sim_spi_ns(Size));
+    if(!spi.addressed){
+        sim.xfers++;
+        spi.addressed = 1;
+        spi.read = (pData[0] & 0x80) != 0;
+        spi.reg = pData[0] & 0x7F;
+        i = 1;
+    }
+    for(; i < Size; i++){
+        if(!spi.read) sim_write_reg(spi.reg++, pData[i]);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout){
+    (void)Timeout;
+
+    if(pending.active) return HAL_BUSY;
+    if(!spi.selected || !spi.addressed) return HAL_ERROR;
+    hspi->ErrorCode = HAL_SPI_ERROR_NONE;
+    sim.bus_bytes += Size;
+    sim_advance_ns(sim_spi_ns(Size));
+    sim_read_burst(spi.reg, pData, Size);
+    if(spi.reg != SIM_FIFO_R_W) spi.reg = (uint8_t)(spi.reg + Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size){
+    if(pending.active) return HAL_BUSY;
+    if(!spi.selected || !spi.addressed) return HAL_ERROR;
+    hspi->ErrorCode = HAL_SPI_ERROR_NONE;
+    pending.active = 1;
+    pending.spi = 1;
+    pending.nack = 0;
+    pending.reg = spi.reg;
+    pending.data = pData;
+    pending.len = Size;
+    if(sim.stall != 0){
+        sim.stall--;
+        pending.done_ns = SIM_NEVER;
+    } else {
+        sim.bus_bytes += Size;
+        pending.done_ns = now_ns + sim_spi_ns(Size);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_IT(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size){
+    return HAL_SPI_Receive_DMA(hspi, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi){
+    (void)hspi;
+    if(pending.active && pending.spi){
+        pending.active = 0;
+        sim.aborts++;
+    }
+    return HAL_OK;
+}
+
+uint32_t HAL_SPI_GetError(SPI_HandleTypeDef *hspi){
+    return hspi->ErrorCode;
+}
+
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi){
+    (void)hspi;
+    return (pending.active && pending.spi) ? HAL_SPI_STATE_BUSY_RX : HAL_SPI_STATE_READY;
+}
+
+__attribute__((weak)) void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi){
+    (void)hspi;
+}
+
+__attribute__((weak)) void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi){
+    (void)hspi;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init){
+    (void)GPIOx;
+    (void)GPIO_Init;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState){
+    if(GPIOx == MPU_CS_GPIO_Port && GPIO_Pin == MPU_CS_Pin){
+        if(PinState == GPIO_PIN_RESET && !spi.selected){
+            spi.selected = 1;
+            spi.addressed = 0;
+        } else if(PinState == GPIO_PIN_SET){
+            spi.selected = 0;
+        }
+    } else if(GPIOx == I2C1_SCL_GPIO_Port && GPIO_Pin == I2C1_SCL_Pin){
+        if(PinState == GPIO_PIN_SET && !scl_level){
+            // Rising edge: the sensor shifts out one more bit
+            sim.scl_pulses++;
+            if(sim.stuck_sda != 0) sim.stuck_sda--;
+        }
+        scl_level = (PinState == GPIO_PIN_SET);
+    }
+    if(PinState == GPIO_PIN_SET) GPIOx->ODR |= GPIO_Pin;
+    else GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin){
+    if(GPIOx == I2C1_SDA_GPIO_Port && GPIO_Pin == I2C1_SDA_Pin){
+        return (sim.stuck_sda != 0) ? GPIO_PIN_RESET : GPIO_PIN_SET;
+    }
+    return (GPIOx->ODR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_Delay(uint32_t Delay){
+    sim_advance_ns((uint64_t)Delay * 1000000U);
+}
+
+uint32_t HAL_GetTick(void){
+    return (uint32_t)(now_ns / 1000000U);
+}
@@ -0,0 +1,151 @@
+/**
+ * @file main.h
+ * @brief Host stand-in for the STM32Cube main.h used by the driver tests
+ * @details Declares the subset of the STM32 HAL that mpu6500.c uses. The
+ *          functions are implemented by hal_stub.c on top of a simulated
+ *          MPU6500 and a simulated clock.
+ */
+
+#ifndef MAIN_H
+#define MAIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HAL_I2C_MODULE_ENABLED
+#define HAL_SPI_MODULE_ENABLED
+
+/* HAL status */
+typedef enum {
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY   0xFFFFFFFFU
+
+/* GPIO */
+typedef struct {
+    volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_0              0x0001U
+#define GPIO_PIN_4              0x0010U
+#define GPIO_PIN_6              0x0040U
+#define GPIO_PIN_7              0x0080U
+#define GPIO_MODE_OUTPUT_OD     0x00000011U
+#define GPIO_NOPULL             0x00000000U
+#define GPIO_SPEED_FREQ_LOW     0x00000000U
+
+extern GPIO_TypeDef sim_gpioa, sim_gpiob;
+#define GPIOA   (&sim_gpioa)
+#define GPIOB   (&sim_gpiob)
+
+/* Board pins, as generated by CubeMX */
+#define MPU_INT_Pin             GPIO_PIN_0
+#define MPU_INT_GPIO_Port       GPIOA
+#define MPU_CS_Pin              GPIO_PIN_4
+#define MPU_CS_GPIO_Port        GPIOA
+#define I2C1_SCL_Pin            GPIO_PIN_6
+#define I2C1_SCL_GPIO_Port      GPIOB
+#define I2C1_SDA_Pin            GPIO_PIN_7
+#define I2C1_SDA_GPIO_Port      GPIOB
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+/* I2C */
+typedef struct {
+    volatile uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT    0x00000001U
+#define HAL_I2C_ERROR_NONE      0x00000000U
+#define HAL_I2C_ERROR_BERR      0x00000001U
+#define HAL_I2C_ERROR_ARLO      0x00000002U
+#define HAL_I2C_ERROR_AF        0x00000004U
+#define HAL_I2C_ERROR_OVR       0x00000008U
+#define HAL_I2C_ERROR_DMA       0x00000010U
+#define HAL_I2C_ERROR_TIMEOUT   0x00000020U
+
+typedef enum {
+    HAL_I2C_STATE_RESET = 0x00U,
+    HAL_I2C_STATE_READY = 0x20U,
+    HAL_I2C_STATE_BUSY_RX = 0x22U
+} HAL_I2C_StateTypeDef;
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+/* SPI */
+typedef struct {
+    volatile uint32_t CR1;
+} SPI_TypeDef;
+
+typedef struct {
+    uint32_t BaudRatePrescaler;
+} SPI_InitTypeDef;
+
+typedef struct {
+    SPI_TypeDef *Instance;
+    SPI_InitTypeDef Init;
+    volatile uint32_t ErrorCode;
+} SPI_HandleTypeDef;
+
+#define SPI_CR1_SPE                 (0x1U << 6)
+#define SPI_CR1_BR                  (0x7U << 3)
+#define SPI_BAUDRATEPRESCALER_4     (0x1U << 3)
+#define SPI_BAUDRATEPRESCALER_64    (0x5U << 3)
+#define HAL_SPI_ERROR_NONE          0x00000000U
+#define HAL_SPI_ERROR_MODF          0x00000001U
+#define HAL_SPI_ERROR_OVR           0x00000004U
+#define HAL_SPI_ERROR_DMA           0x00000010U
+
+typedef enum {
+    HAL_SPI_STATE_RESET = 0x00U,
+    HAL_SPI_STATE_READY = 0x01U,
+    HAL_SPI_STATE_BUSY_RX = 0x04U
+} HAL_SPI_StateTypeDef;
+
+#define MODIFY_REG(REG, CLEARMASK, SETMASK)  ((REG) = (((REG) & (~(CLEARMASK))) | (SETMASK)))
+#define __HAL_SPI_DISABLE(__HANDLE__)        ((__HANDLE__)->Instance->CR1 &= ~SPI_CR1_SPE)
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive_IT(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+uint32_t HAL_SPI_GetError(SPI_HandleTypeDef *hspi);
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi);
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+/* Time base */
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+
+#endif /* MAIN_H */
@@ -0,0 +1,108 @@
+/**
+ * @file sim.h
+ * @brief Simulated MPU6500, bus and clock behind the stub HAL
+ * @details Register accesses through the stub HAL hit a simulated register
+ *          file. Every transfer advances a simulated clock by its duration
+ *          on the bus; non-blocking transfers complete (and call the HAL
+ *          callbacks) when sim_advance_us() moves the clock past their end.
+ *          With sample_ns set, the sensor also samples on that clock and
+ *          feeds the enabled channels into its FIFO, like the real part.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "main.h"
+#include <stdio.h>
+
+/* Peripheral handles the stub HAL drives */
+extern I2C_HandleTypeDef hi2c1;
+extern SPI_HandleTypeDef hspi1;
+
+/**
+ * @brief Simulator state, reset by sim_reset()
+ */
+typedef struct {
+    uint8_t regs[128];          // Sensor register file
+    uint32_t i2c_hz;            // I2C bus clock
+    uint32_t spi_hz;            // SPI bus clock
+    // Fault injection
+    uint32_t nack;              // Next transfers NACKed by the sensor
+    uint32_t stall;             // Next transfers that never complete (HAL_TIMEOUT / no callback)
+    uint32_t stuck_sda;         // SCL clocks until the sensor releases SDA, bus busy until then
+    void (*sensor)(void);       // Called before each register read, to model changing data
+    // Sensor clock
+    uint32_t sample_ns;         // Sample period of the sensor, 0: the FIFO is only fed by sim_fifo_push
+    void (*sample)(void);       // Called at each sample before it is queued, to model changing data
+    // Counters
+    uint32_t xfers;             // Transfers started on the bus
+    uint32_t bus_bytes;         // Bytes on the bus (address, register and data)
+    uint32_t inits;             // HAL_I2C_Init calls
+    uint32_t aborts;            // Non-blocking transfers aborted
+    uint32_t scl_pulses;        // SCL pulses clocked by GPIO
+    uint32_t resets;            // DEVICE_RESET writes
+    uint32_t samples;           // Samples taken on the sensor clock
+} SimState;
+
+extern SimState sim;
+
+/**
+ * @brief Reset the simulated sensor, bus and clock to power-on state
+ */
+void sim_reset(void);
+
+/**
+ * @brief Advance the simulated clock, completing non-blocking transfers that end
+ * @param us Time to advance in µs
+ */
+void sim_advance_us(uint32_t us);
+
+/**
+ * @brief Current simulated time
+ * @return uint64_t Time since sim_reset() in µs
+ */
+uint64_t sim_time_us(void);
+
+/**
+ * @brief Check whether a non-blocking transfer is in flight
+ * @return int 1 if a transfer is pending, else 0
+ */
+int sim_busy(void);
+
+/**
+ * @brief Store a sensor frame in ACCEL_XOUT_H..GYRO_ZOUT_L
+ * @param accel Raw accelerometer X/Y/Z
+ * @param temp Raw temperature
+ * @param gyro Raw gyroscope X/Y/Z
+ */
+void sim_set_sample(const int16_t accel[3], int16_t temp, const int16_t gyro[3]);
+
+/**
+ * @brief Append bytes to the simulated FIFO, dropping the oldest on overflow
+ * @param data Bytes to append
+ * @param len Number of bytes
+ */
+void sim_fifo_push(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Number of bytes in the simulated FIFO
+ * @return uint16_t FIFO_COUNT
+ */
+uint16_t sim_fifo_count(void);
+
+/**
+ * @brief Simulate a power-on reset of the sensor (brown-out)
+ */
+void sim_power_cycle(void);
+
+/* Test helpers */
+extern int sim_failures;
+
+#define CHECK(cond) do { \
+    if(!(cond)){ \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        sim_failures++; \
+    } \
+} while(0)
+
+#endif /* SIM_H */
@@ -0,0 +1,161 @@
+/**
+ * @file test_async.c
+ * @brief Non-blocking acquisition: start -> HAL callback -> MPU6500_GetAsyncSample
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+
+static MPU6500_Transport bus;
+static MPU6500_SPI_Bus spi_bus = { &hspi1, MPU_CS_GPIO_Port, MPU_CS_Pin, 0, 0, 0 };
+static MPU6500_Handle hmpu;
+
+static const int16_t accel[3] = { 2048, -4096, 1000 };
+static const int16_t gyro[3] = { -1640, 164, 0 };
+
+/* HAL callbacks routed to the driver, as in the README */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    MPU6500_I2C_MemRxCpltCallback(&hmpu, hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c){
+    MPU6500_I2C_ErrorCallback(&hmpu, hi2c);
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi){
+    MPU6500_SPI_RxCpltCallback(&hmpu, hspi);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi){
+    MPU6500_SPI_ErrorCallback(&hmpu, hspi);
+}
+
+static void setup(uint8_t type){
+    sim_reset();
+    if(type == MPU6500_BUS_SPI){
+        MPU6500_Transport_InitSPI(&bus, &spi_bus);
+    } else {
+        MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    }
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    sim_set_sample(accel, 340, gyro);
+}
+
+static void check_sample(const MPU6500_Sample *sample, uint8_t with_temp){
+    for(int i = 0; i < 3; i++){
+        CHECK(sample->accel[i] == (float)accel[i] * hmpu.accel_scale);
+        CHECK(sample->gyro[i] == (float)gyro[i] * hmpu.gyro_scale);
+    }
+    if(with_temp) CHECK(sample->temp == 340.0f / MPU6500_TEMP_SENS + MPU6500_TEMP_OFFSET);
+}
+
+/* 14-byte DMA burst: 9 * 17 + 3 bits at 400 kHz = 390 µs on the bus */
+static void test_dma_burst(void){
+    MPU6500_Sample sample;
+
+    setup(MPU6500_BUS_I2C);
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_OK);
+    CHECK(MPU6500_GetAsyncState(&hmpu) == MPU6500_ASYNC_BUSY);
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_BUSY);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_BUSY);
+
+    sim_advance_us(300);
+    CHECK(MPU6500_GetAsyncState(&hmpu) == MPU6500_ASYNC_BUSY);
+    sim_advance_us(100);
+    CHECK(MPU6500_GetAsyncState(&hmpu) == MPU6500_ASYNC_READY);
+
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_OK);
+    check_sample(&sample, 1);
+    CHECK(MPU6500_GetAsyncState(&hmpu) == MPU6500_ASYNC_IDLE);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_ERROR);
+}
+
+/* Separate accel and gyro steps, chained from the completion callback */
+static void test_it_chain(void){
+    MPU6500_Sample sample;
+    uint32_t xfers;
+
+    setup(MPU6500_BUS_I2C);
+    xfers = sim.xfers;
+    CHECK(MPU6500_StartRead_IT(&hmpu, MPU6500_READ_ACCEL | MPU6500_READ_GYRO) == HAL_OK);
+    sim_advance_us(250);    // First step (6 bytes, 240 µs) done
+    CHECK(MPU6500_GetAsyncState(&hmpu) == MPU6500_ASYNC_BUSY);
+    CHECK(sim.xfers == xfers + 2);
+    sim_advance_us(250);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_OK);
+    check_sample(&sample, 0);
+}
+
+/* A NACKed step is re-issued from the error callback */
+static void test_nack_reissue(void){
+    MPU6500_Sample sample;
+
+    setup(MPU6500_BUS_I2C);
+    sim.nack = 1;
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_OK);
+    sim_advance_us(1000);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_OK);
+    check_sample(&sample, 1);
+    CHECK(MPU6500_GetStats(&hmpu)->nacks == 1);
+
+    sim.nack = 1 + MPU6500_ASYNC_MAX_RETRIES;
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_OK);
+    sim_advance_us(1000);
+    CHECK(MPU6500_GetAsyncState(&hmpu) == MPU6500_ASYNC_ERROR);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_ERROR);
+}
+
+/* SPI: chip select stays low until the completion callback */
+static void test_spi_dma(void){
+    MPU6500_Sample sample;
+
+    setup(MPU6500_BUS_SPI);
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_OK);
+    CHECK(HAL_GPIO_ReadPin(MPU_CS_GPIO_Port, MPU_CS_Pin) == GPIO_PIN_RESET);
+    sim_advance_us(200);    // 14 bytes at 1 MHz = 112 µs
+    CHECK(HAL_GPIO_ReadPin(MPU_CS_GPIO_Port, MPU_CS_Pin) == GPIO_PIN_SET);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_OK);
+    check_sample(&sample, 1);
+}
+
+/* A transfer that never completes is given up after the read timeout */
+static void test_timeout(void){
+    MPU6500_Sample sample;
+
+    setup(MPU6500_BUS_I2C);
+    sim.stall = 1;
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_OK);
+    sim_advance_us(MPU6500_DEFAULT_READ_TIMEOUT * 1000U);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_BUSY);
+    sim_advance_us(1000);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_TIMEOUT);
+    CHECK(MPU6500_GetAsyncState(&hmpu) == MPU6500_ASYNC_IDLE);
+    CHECK(MPU6500_GetStats(&hmpu)->timeouts == 1);
+
+    // The transfer was aborted: the peripheral takes the next one
+    CHECK(sim.aborts == 1);
+    CHECK(!sim_busy());
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_OK);
+    sim_advance_us(400);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_OK);
+    check_sample(&sample, 1);
+
+    // Same on SPI, chip select is released
+    setup(MPU6500_BUS_SPI);
+    sim.stall = 1;
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_OK);
+    sim_advance_us((MPU6500_DEFAULT_READ_TIMEOUT + 1) * 1000U);
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_TIMEOUT);
+    CHECK(sim.aborts == 1 && !sim_busy());
+    CHECK(HAL_GPIO_ReadPin(MPU_CS_GPIO_Port, MPU_CS_Pin) == GPIO_PIN_SET);
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+}
+
+int main(void){
+    test_dma_burst();
+    test_it_chain();
+    test_nack_reissue();
+    test_spi_dma();
+    test_timeout();
+    return sim_failures != 0;
+}
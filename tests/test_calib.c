@@ -0,0 +1,100 @@
+/**
+ * @file test_calib.c
+ * @brief MPU6500_InitOffsetCalibrationEx: offsets, quality figures and motion rejection
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+#include <math.h>
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+static uint32_t reads;          // Register reads seen by the sensor model
+static uint32_t bump_from, bump_to;
+
+/* Accel and gyro are read separately: one sample per two reads, noise of +-1 and +-3 LSB */
+static void sensor(void){
+    static const int16_t noise[4] = { -3, -1, 1, 3 };
+    uint32_t k = reads++ / 2;
+    int16_t d = noise[k % 4];
+    int16_t x = (k >= bump_from && k < bump_to) ? (int16_t)(100 + 500 * d) : (int16_t)(100 + d);
+    const int16_t accel[3] = { x, (int16_t)(-50 + d), (int16_t)(8192 + 20 + d) };     // Z up at ±4g
+    const int16_t gyro[3] = { (int16_t)(-7 + d), (int16_t)(12 + d), (int16_t)(3 + d) };
+
+    sim_set_sample(accel, 0, gyro);
+}
+
+static void setup(uint32_t from, uint32_t to){
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    reads = 0;
+    bump_from = from;
+    bump_to = to;
+    sim.sensor = sensor;
+}
+
+/* Offsets are the exact means; the noise figure is the sample standard deviation */
+static void test_quiet(void){
+    MPU6500_CalibResult result;
+    float std = sqrtf(80.0f * 20.0f / 319.0f);      // 320 samples of (+-1, +-3)
+
+    setup(0, 0);
+    CHECK(MPU6500_InitOffsetCalibrationEx(&hmpu, 320, &result) == HAL_OK);
+    CHECK(hmpu.accel_offset[0] == 100 && hmpu.accel_offset[1] == -50 && hmpu.accel_offset[2] == 20);
+    CHECK(hmpu.gyro_offset[0] == -7 && hmpu.gyro_offset[1] == 12 && hmpu.gyro_offset[2] == 3);
+    CHECK(result.samples == 320 && result.windows == 10 && result.rejected == 0);
+    CHECK(result.quality == 100 && !result.converged);
+    CHECK(fabsf(result.accel_noise_g - std * hmpu.accel_scale) < 1e-6f);
+    CHECK(fabsf(result.gyro_noise_dps - std * hmpu.gyro_scale) < 1e-5f);
+
+    // The legacy entry point gives the same offsets
+    setup(0, 0);
+    CHECK(MPU6500_InitOffsetCalibration(&hmpu, 320) == HAL_OK);
+    CHECK(hmpu.accel_offset[0] == 100 && hmpu.gyro_offset[2] == 3);
+}
+
+/* Beyond the 32768 samples of a window check the noise figure is still the exact sample deviation */
+static void test_long(void){
+    MPU6500_CalibResult result;
+    float std = sqrtf(5.0f * 40000.0f / 39999.0f);
+
+    setup(0, 0);
+    CHECK(MPU6500_InitOffsetCalibrationEx(&hmpu, 40000, &result) == HAL_OK);
+    CHECK(result.samples == 40000 && result.rejected == 0);
+    CHECK(hmpu.accel_offset[0] == 100 && hmpu.gyro_offset[2] == 3);
+    CHECK(fabsf(result.accel_noise_g - std * hmpu.accel_scale) < 1e-6f);
+    CHECK(fabsf(result.gyro_noise_dps - std * hmpu.gyro_scale) < 1e-5f);
+}
+
+/* A bump drops its window, which is collected again */
+static void test_bump(void){
+    MPU6500_CalibResult result;
+
+    setup(64, 96);
+    CHECK(MPU6500_InitOffsetCalibrationEx(&hmpu, 320, &result) == HAL_OK);
+    CHECK(result.samples == 320 && result.windows == 10 && result.rejected == 1);
+    CHECK(result.quality == 90);
+    CHECK(hmpu.accel_offset[0] == 100);
+}
+
+/* A sensor that keeps moving fails the call and leaves the offsets alone */
+static void test_moving(void){
+    MPU6500_CalibResult result;
+
+    setup(0, UINT32_MAX);
+    hmpu.accel_offset[0] = 42;
+    CHECK(MPU6500_InitOffsetCalibrationEx(&hmpu, 320, &result) == HAL_ERROR);
+    CHECK(hmpu.accel_offset[0] == 42);
+    CHECK(result.samples == 0 && result.rejected == MPU6500_CALIB_MAX_REJECTS + 1);
+    CHECK(result.quality == 0);
+}
+
+int main(void){
+    test_quiet();
+    test_long();
+    test_bump();
+    test_moving();
+    return sim_failures != 0;
+}
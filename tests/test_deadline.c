@@ -0,0 +1,95 @@
+/**
+ * @file test_deadline.c
+ * @brief MPU6500_ReadAllWithin: budget check, retries within the deadline, auto-range
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+static void setup(void){
+    static const int16_t accel[3] = { 100, 200, 300 };
+    static const int16_t gyro[3] = { 1, 2, 3 };
+
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    sim_set_sample(accel, 0, gyro);
+}
+
+/* 14 bytes at 400 kHz: 390 µs + MPU6500_XFER_OVERHEAD_US */
+static void test_budget(void){
+    MPU6500_Sample sample;
+    uint32_t xfers;
+
+    setup();
+    CHECK(MPU6500_EstimateReadTime(&hmpu, MPU6500_SAMPLE_SIZE) == 410);
+    xfers = sim.xfers;
+    CHECK(MPU6500_ReadAllWithin(&hmpu, &sample, 409) == HAL_TIMEOUT);
+    CHECK(sim.xfers == xfers);
+    CHECK(MPU6500_GetStats(&hmpu)->deadline_skips == 1);
+    CHECK(MPU6500_ReadAllWithin(&hmpu, &sample, 410) == HAL_OK);
+    CHECK(sample.accel[2] == 300.0f * hmpu.accel_scale);
+}
+
+/* A NACK is retried only if the 1 ms backoff and another transfer still fit */
+static void test_retry(void){
+    MPU6500_Sample sample;
+    const MPU6500_Stats *stats;
+
+    setup();
+    stats = MPU6500_GetStats(&hmpu);
+    sim.nack = 1;
+    CHECK(MPU6500_ReadAllWithin(&hmpu, &sample, 2000) == HAL_OK);
+    CHECK(stats->nacks == 1 && stats->retries == 1 && stats->failures == 0);
+    CHECK(sample.accel[0] == 100.0f * hmpu.accel_scale);
+
+    sim.nack = 1;
+    CHECK(MPU6500_ReadAllWithin(&hmpu, &sample, 1000) == HAL_ERROR);
+    CHECK(stats->nacks == 2 && stats->retries == 1 && stats->failures == 1);
+}
+
+/* A stalled transfer times out with the budget rounded up to ticks */
+static void test_stall(void){
+    MPU6500_Sample sample;
+    uint64_t start;
+
+    setup();
+    sim.stall = 1;
+    start = sim_time_us();
+    CHECK(MPU6500_ReadAllWithin(&hmpu, &sample, 1500) == HAL_TIMEOUT);
+    CHECK(sim_time_us() - start == 2000);
+    CHECK(MPU6500_GetStats(&hmpu)->timeouts == 1);
+    CHECK(MPU6500_GetStats(&hmpu)->retries == 0);
+}
+
+/* A pending range switch is written only if the time left covers it */
+static void test_autorange(void){
+    static const int16_t loud[3] = { 32000, 0, 0 };
+    static const int16_t gyro[3] = { 0, 0, 0 };
+    MPU6500_Sample sample;
+
+    setup();
+    CHECK(MPU6500_SetFullScale(&hmpu, MPU6500_ACCEL_FS_2G, MPU6500_GYRO_FS_250DPS) == HAL_OK);
+    MPU6500_SetAutoRange(&hmpu, MPU6500_AUTORANGE_ACCEL);
+    sim_set_sample(loud, 0, gyro);
+
+    CHECK(MPU6500_ReadAllWithin(&hmpu, &sample, 410) == HAL_OK);
+    CHECK(sample.settling);
+    CHECK(MPU6500_ReadAllWithin(&hmpu, &sample, 410) == HAL_OK);
+    CHECK(!sample.settling);
+    CHECK(hmpu.accel_fs == MPU6500_ACCEL_FS_2G);            // No time left, still pending
+    CHECK(MPU6500_ReadAllWithin(&hmpu, &sample, 1000) == HAL_OK);
+    CHECK(hmpu.accel_fs == MPU6500_ACCEL_FS_4G);
+    CHECK(MPU6500_GetStats(&hmpu)->range_switches == 1);
+}
+
+int main(void){
+    test_budget();
+    test_retry();
+    test_stall();
+    test_autorange();
+    return sim_failures != 0;
+}
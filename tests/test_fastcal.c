@@ -0,0 +1,126 @@
+/**
+ * @file test_fastcal.c
+ * @brief MPU6500_FastOffsetCalibration: convergence, motion rejection, the
+ *        FIFO timeout, the 500 ms budget and the restored streaming setup
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+
+#define BUDGET_US   500000U     // Readiness budget of the defaults at 1 kHz
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+static int16_t swing;           // Peak-to-peak noise scale, in LSB per noise step
+static int16_t ramp;            // Accel X change per sample, in LSB
+
+/* One sample per sensor clock tick, noise of +-1 and +-3 steps */
+static void sample(void){
+    static const int16_t noise[4] = { -3, -1, 1, 3 };
+    int16_t d = (int16_t)(noise[sim.samples % 4] * swing);
+    int16_t x = (int16_t)(100 + d + ramp * (int16_t)(sim.samples % 1024));
+    const int16_t accel[3] = { x, (int16_t)(-50 + d), (int16_t)(8192 + 20 + d) };     // Z up at ±4g
+    const int16_t gyro[3] = { (int16_t)(-7 + d), (int16_t)(12 + d), (int16_t)(3 + d) };
+
+    sim_set_sample(accel, 0, gyro);
+}
+
+static void setup(int16_t noise_swing, int16_t accel_ramp){
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    CHECK(MPU6500_GetOutputDataRate(&hmpu) == 1000.0f);
+    swing = noise_swing;
+    ramp = accel_ramp;
+    sim.sample = sample;
+    sim.sample_ns = 1000000;
+}
+
+/* A still sensor converges after MPU6500_CALIB_MIN_SAMPLES and gets the exact means */
+static void test_converge(void){
+    MPU6500_CalibResult result;
+    uint64_t start;
+
+    setup(1, 0);
+    start = sim_time_us();
+    CHECK(MPU6500_FastOffsetCalibration(&hmpu, NULL, &result) == HAL_OK);
+    CHECK(sim_time_us() - start < BUDGET_US);
+    CHECK(result.converged && result.samples == MPU6500_CALIB_MIN_SAMPLES);
+    CHECK(result.rejected == 0 && result.quality == 100);
+    CHECK(hmpu.accel_offset[0] == 100 && hmpu.accel_offset[1] == -50 && hmpu.accel_offset[2] == 20);
+    CHECK(hmpu.gyro_offset[0] == -7 && hmpu.gyro_offset[1] == 12 && hmpu.gyro_offset[2] == 3);
+}
+
+/* Means that keep moving stop the run at MPU6500_CALIB_MAX_SAMPLES, within budget */
+static void test_drift(void){
+    MPU6500_CalibResult result;
+    uint64_t start;
+
+    setup(1, 1);
+    start = sim_time_us();
+    CHECK(MPU6500_FastOffsetCalibration(&hmpu, NULL, &result) == HAL_OK);
+    CHECK(sim_time_us() - start < BUDGET_US);
+    CHECK(!result.converged && result.samples == MPU6500_CALIB_MAX_SAMPLES);
+}
+
+/* A sensor that keeps moving fails fast and leaves the offsets alone */
+static void test_moving(void){
+    MPU6500_CalibResult result;
+    uint64_t start;
+
+    setup(500, 0);
+    hmpu.accel_offset[0] = 42;
+    start = sim_time_us();
+    CHECK(MPU6500_FastOffsetCalibration(&hmpu, NULL, &result) == HAL_ERROR);
+    CHECK(sim_time_us() - start < BUDGET_US);
+    CHECK(result.samples == 0 && result.rejected == MPU6500_CALIB_MAX_REJECTS + 1);
+    CHECK(hmpu.accel_offset[0] == 42);
+}
+
+/* A FIFO that delivers nothing times out within budget */
+static void test_timeout(void){
+    MPU6500_CalibResult result;
+    uint64_t start;
+
+    setup(1, 0);
+    sim.sample_ns = 0;
+    start = sim_time_us();
+    CHECK(MPU6500_FastOffsetCalibration(&hmpu, NULL, &result) == HAL_TIMEOUT);
+    CHECK(sim_time_us() - start < BUDGET_US);
+    CHECK(result.samples == 0);
+}
+
+/* Streaming continues with the previous channels, or stays off */
+static void test_restore(void){
+    uint8_t buffer[16 * 6];
+    MPU6500_FIFO_Batch batch;
+
+    setup(1, 0);
+    CHECK(MPU6500_FIFO_Enable(&hmpu, MPU6500_FIFO_GYRO) == HAL_OK);
+    CHECK(MPU6500_FastOffsetCalibration(&hmpu, NULL, NULL) == HAL_OK);
+    CHECK(hmpu.fifo.channels == MPU6500_FIFO_GYRO && hmpu.fifo.frame_size == 6);
+    CHECK(sim.regs[0x23] == MPU6500_FIFO_GYRO && (sim.regs[0x6A] & 0x40));
+    sim_advance_us(10000);
+    CHECK(MPU6500_FIFO_Read(&hmpu, buffer, 16, &batch) == HAL_OK);
+    CHECK(batch.frames >= 10 && !batch.resync);
+
+    setup(1, 0);
+    CHECK(MPU6500_FastOffsetCalibration(&hmpu, NULL, NULL) == HAL_OK);
+    CHECK(hmpu.fifo.channels == 0 && !(sim.regs[0x6A] & 0x40));
+
+    // Also after a failed run
+    setup(500, 0);
+    CHECK(MPU6500_FIFO_Enable(&hmpu, MPU6500_FIFO_ACCEL) == HAL_OK);
+    CHECK(MPU6500_FastOffsetCalibration(&hmpu, NULL, NULL) == HAL_ERROR);
+    CHECK(hmpu.fifo.channels == MPU6500_FIFO_ACCEL && sim.regs[0x23] == MPU6500_FIFO_ACCEL);
+}
+
+int main(void){
+    test_converge();
+    test_drift();
+    test_moving();
+    test_timeout();
+    test_restore();
+    return sim_failures != 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file test_faults.c
+ * @brief Fault injection: NACKs, stuck SDA, stalled transfers, sensor brown-out
+ *        and a bus shared with another sensor's non-blocking transfer
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+#include <string.h>
+
+static MPU6500_Transport bus;
+static MPU6500_I2C_Recovery recovery = {
+    &hi2c1, I2C1_SCL_GPIO_Port, I2C1_SCL_Pin, I2C1_SDA_GPIO_Port, I2C1_SDA_Pin
+};
+static MPU6500_Handle hmpu, other;
+
+/* Both sensors share hi2c1, each ignores completions it did not start */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    MPU6500_I2C_MemRxCpltCallback(&other, hi2c);
+    MPU6500_I2C_MemRxCpltCallback(&hmpu, hi2c);
+}
+
+static const int16_t accel[3] = { 10, 20, 30 };
+static const int16_t gyro[3] = { -1, -2, -3 };
+
+static void setup(uint8_t unstick){
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    if(unstick) MPU6500_Transport_SetI2CRecovery(&bus, &recovery);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    sim_set_sample(accel, 0, gyro);
+}
+
+/* NACKs are retried after the backoff, without bus recovery */
+static void test_nack(void){
+    const MPU6500_Stats *stats;
+    MPU6500_Sample sample;
+    uint64_t start;
+
+    setup(0);
+    stats = MPU6500_GetStats(&hmpu);
+    sim.nack = MPU6500_DEFAULT_RETRIES;
+    start = sim_time_us();
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(sample.gyro[2] == -3.0f * hmpu.gyro_scale);
+    CHECK(stats->nacks == 2 && stats->retries == 2 && stats->recoveries == 0);
+    CHECK(sim_time_us() - start >= 1000 + 2000);    // 1 ms, then 2 ms backoff
+
+    sim.nack = MPU6500_DEFAULT_RETRIES + 1;
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_ERROR);
+    CHECK(stats->nacks == 5 && stats->failures == 1);
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+}
+
+/* A sensor holding SDA low is clocked free by the recovery, then retried */
+static void test_stuck_sda(void){
+    const MPU6500_Stats *stats;
+    MPU6500_Sample sample;
+
+    setup(1);
+    stats = MPU6500_GetStats(&hmpu);
+    sim.stuck_sda = 5;
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(sample.accel[1] == 20.0f * hmpu.accel_scale);
+    CHECK(stats->bus_errors == 1 && stats->recoveries == 1 && stats->retries == 1);
+    CHECK(sim.scl_pulses == 5 + 1);                   // Plus the STOP condition
+    CHECK(sim.inits == 1);
+
+    // Longer than the 9 clocks of one recovery: every retry clocks 9 more
+    sim.stuck_sda = 15;
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(stats->recoveries == 3 && stats->failures == 0);
+}
+
+/* Without retries the failed call still recovers the bus for the next one */
+static void test_no_retries(void){
+    static const MPU6500_RetryPolicy once = { 0, 1, 8 };
+    const MPU6500_Stats *stats;
+    MPU6500_Sample sample;
+
+    setup(1);
+    stats = MPU6500_GetStats(&hmpu);
+    MPU6500_SetRetryPolicy(&hmpu, &once);
+    sim.stuck_sda = 3;
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_BUSY);
+    CHECK(stats->failures == 1 && stats->retries == 0 && stats->recoveries == 1);
+    CHECK(sim.stuck_sda == 0);
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(stats->recoveries == 1);
+}
+
+/* A stalled transfer times out, the peripheral is re-initialized and the read retried */
+static void test_stall(void){
+    const MPU6500_Stats *stats;
+    MPU6500_Sample sample;
+
+    setup(0);
+    stats = MPU6500_GetStats(&hmpu);
+    sim.stall = 1;
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(stats->timeouts == 1 && stats->recoveries == 1 && sim.inits == 1);
+}
+
+/* CheckHealth writes the configuration back after a sensor brown-out */
+static void test_brownout(void){
+    uint8_t before[sizeof(sim.regs)];
+    MPU6500_Sample sample;
+
+    setup(0);
+    CHECK(MPU6500_SetFullScale(&hmpu, MPU6500_ACCEL_FS_4G, MPU6500_GYRO_FS_500DPS) == HAL_OK);
+    memcpy(before, sim.regs, sizeof(before));
+    CHECK(MPU6500_CheckHealth(&hmpu) == HAL_OK);
+    CHECK(MPU6500_GetStats(&hmpu)->restores == 0);
+
+    sim_power_cycle();
+    sim_set_sample(accel, 0, gyro);
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);  // Sensor answers, at its defaults
+    CHECK(MPU6500_CheckHealth(&hmpu) == HAL_OK);
+    CHECK(MPU6500_GetStats(&hmpu)->restores == 1);
+    CHECK(memcmp(&sim.regs[0x19], &before[0x19], 5) == 0);     // SMPLRT_DIV..ACCEL_CONFIG_2
+    CHECK(sim.regs[0x6A] == before[0x6A] && sim.regs[0x6B] == before[0x6B]);
+    CHECK(MPU6500_CheckHealth(&hmpu) == HAL_OK);
+    CHECK(MPU6500_GetStats(&hmpu)->restores == 1);
+}
+
+/* Retry delays stop doubling at the cap, even past 32 retries */
+static void test_long_backoff(void){
+    static const MPU6500_RetryPolicy many = { 40, 1, 8 };
+    MPU6500_Sample sample;
+    uint64_t start;
+
+    setup(0);
+    MPU6500_SetRetryPolicy(&hmpu, &many);
+    sim.nack = 40;
+    start = sim_time_us();
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(MPU6500_GetStats(&hmpu)->retries == 40);
+    CHECK(sim_time_us() - start >= (1 + 2 + 4 + 37 * 8) * 1000U);
+    CHECK(sim_time_us() - start < (1 + 2 + 4 + 37 * 8 + 20) * 1000U);
+}
+
+/* A blocking read that finds another sensor's DMA on the bus waits for it */
+static void test_shared_bus(void){
+    const MPU6500_Stats *stats;
+    MPU6500_Sample sample;
+
+    setup(1);
+    CHECK(MPU6500_Init(&other, &bus, MPU6500_ADDR) == HAL_OK);
+    sim_set_sample(accel, 0, gyro);     // Init reset the simulated sensor
+    stats = MPU6500_GetStats(&hmpu);
+    CHECK(MPU6500_StartReadAll_DMA(&other) == HAL_OK);
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(sample.accel[2] == 30.0f * hmpu.accel_scale);
+    CHECK(stats->busy == 1 && stats->retries == 1);
+    CHECK(stats->bus_errors == 0 && stats->recoveries == 0 && sim.inits == 0);
+
+    // The other sensor's transfer was not dropped
+    CHECK(MPU6500_GetAsyncState(&other) == MPU6500_ASYNC_READY);
+    CHECK(MPU6500_GetAsyncSample(&other, &sample) == HAL_OK);
+    CHECK(sample.gyro[1] == -2.0f * other.gyro_scale);
+}
+
+int main(void){
+    test_nack();
+    test_stuck_sda();
+    test_no_retries();
+    test_stall();
+    test_brownout();
+    test_long_backoff();
+    test_shared_bus();
+    return sim_failures != 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file test_hwoffsets.c
+ * @brief MPU6500_ApplyHardwareOffsets: sign, scaling and register layout of
+ *        the accel and gyro offset registers
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+static void setup(uint8_t accel_fs, uint8_t gyro_fs){
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    CHECK(MPU6500_SetFullScale(&hmpu, accel_fs, gyro_fs) == HAL_OK);
+}
+
+static void set_word(uint8_t reg, uint16_t value){
+    sim.regs[reg] = (uint8_t)(value >> 8);
+    sim.regs[reg + 1] = (uint8_t)value;
+}
+
+static uint16_t word(uint8_t reg){
+    return (uint16_t)((sim.regs[reg] << 8) | sim.regs[reg + 1]);
+}
+
+/*
+ * Accel offsets are ±16 g words with the value in bits [15:1] (0.98 mg per
+ * step) and the temperature compensation flag in bit 0. A positive bias is
+ * subtracted, whatever the measurement range.
+ */
+static void test_accel(void){
+    static const uint8_t ranges[2] = { MPU6500_ACCEL_FS_16G, MPU6500_ACCEL_FS_2G };
+    static const float sens[2] = { 2048.0f, 16384.0f };
+
+    for(int r = 0; r < 2; r++){
+        setup(ranges[r], MPU6500_GYRO_FS_250DPS);
+        set_word(0x77, 0x1235);                     // XA_OFFSET: factory trim, bit 0 set
+        set_word(0x7A, 0x0000);                     // YA_OFFSET: bit 0 clear
+        set_word(0x7D, 0xFFFF);                     // ZA_OFFSET: -1, bit 0 set
+        sim.regs[0x79] = sim.regs[0x7C] = 0xA5;     // Reserved, must stay
+        hmpu.accel_offset[0] = (int16_t)sens[r];                    // +1 g: 1024 steps
+        hmpu.accel_offset[1] = (int16_t)(-5.2f * sens[r] / 1024.0f); // -5.2 mg: +5 steps
+        hmpu.accel_offset[2] = (int16_t)(2.0f * sens[r] / 1024.0f); // +1.95 mg: 2 steps
+
+        CHECK(MPU6500_ApplyHardwareOffsets(&hmpu, MPU6500_OFFSET_ACCEL) == HAL_OK);
+        CHECK(word(0x77) == 0x1235 - 2048);
+        CHECK(word(0x7A) == 0x000A);
+        CHECK(word(0x7D) == 0xFFFB);
+        CHECK(sim.regs[0x79] == 0xA5 && sim.regs[0x7C] == 0xA5);
+        CHECK(hmpu.accel_offset[0] == 0 && hmpu.accel_offset[1] == 0 && hmpu.accel_offset[2] == 0);
+        CHECK(hmpu.hw_offset.sensors == MPU6500_OFFSET_ACCEL);
+        CHECK(word(0x13) == 0 && word(0x15) == 0 && word(0x17) == 0);  // Gyro untouched
+    }
+}
+
+/* Gyro offsets are ±1000 °/s words (32.8 LSB per °/s) at XG_OFFSET_H..ZG_OFFSET_L */
+static void test_gyro(void){
+    setup(MPU6500_ACCEL_FS_2G, MPU6500_GYRO_FS_250DPS);
+    set_word(0x13, 100);
+    set_word(0x15, (uint16_t)-20);
+    set_word(0x17, 0);
+    hmpu.gyro_offset[0] = 131;                      // +1 °/s at ±250 °/s: 32.8 LSB
+    hmpu.gyro_offset[1] = -262;                     // -2 °/s: -65.6 LSB
+    hmpu.gyro_offset[2] = 0;
+    hmpu.accel_offset[0] = 77;
+
+    CHECK(MPU6500_ApplyHardwareOffsets(&hmpu, MPU6500_OFFSET_GYRO) == HAL_OK);
+    CHECK((int16_t)word(0x13) == 100 - 33);
+    CHECK((int16_t)word(0x15) == -20 + 66);
+    CHECK((int16_t)word(0x17) == 0);
+    CHECK(hmpu.gyro_offset[0] == 0 && hmpu.gyro_offset[1] == 0);
+    CHECK(hmpu.accel_offset[0] == 77 && hmpu.hw_offset.sensors == MPU6500_OFFSET_GYRO);
+
+    // Same bias at ±2000 °/s gives the same register value
+    setup(MPU6500_ACCEL_FS_2G, MPU6500_GYRO_FS_2000DPS);
+    set_word(0x13, 100);
+    hmpu.gyro_offset[0] = 16;                       // 0.98 °/s at 16.4 LSB/°/s
+    CHECK(MPU6500_ApplyHardwareOffsets(&hmpu, MPU6500_OFFSET_GYRO) == HAL_OK);
+    CHECK((int16_t)word(0x13) == 100 - 32);
+}
+
+/* The registers are lost on a reset: MPU6500_CheckHealth writes them back */
+static void test_restore(void){
+    setup(MPU6500_ACCEL_FS_16G, MPU6500_GYRO_FS_250DPS);
+    set_word(0x77, 0x1235);
+    hmpu.accel_offset[0] = 2048;
+    hmpu.gyro_offset[2] = 131;
+    CHECK(MPU6500_ApplyHardwareOffsets(&hmpu, MPU6500_OFFSET_ALL) == HAL_OK);
+    sim_power_cycle();
+    CHECK(MPU6500_CheckHealth(&hmpu) == HAL_OK);
+    CHECK(word(0x77) == 0x1235 - 2048 && (int16_t)word(0x17) == -33);
+}
+
+int main(void){
+    test_accel();
+    test_gyro();
+    test_restore();
+    return sim_failures != 0;
+}
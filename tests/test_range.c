@@ -0,0 +1,119 @@
+/**
+ * @file test_range.c
+ * @brief Full scale switching: FIFO frames across a range change, settling
+ *        samples and auto-ranging of non-blocking reads
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c){
+    MPU6500_I2C_MemRxCpltCallback(&hmpu, hi2c);
+}
+
+static void setup(void){
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+}
+
+/* Queue accel-only frames with X = value */
+static void push_frames(int16_t value, int count){
+    uint8_t frame[6] = { (uint8_t)((uint16_t)value >> 8), (uint8_t)value, 0, 0, 0, 0 };
+    for(int i = 0; i < count; i++) sim_fifo_push(frame, sizeof(frame));
+}
+
+/* Frames queued at 2g are dropped, not decoded as 4 g at 8g */
+static void test_fifo_switch(void){
+    uint8_t buffer[8 * 6];
+    float x[8], y[8], z[8];
+    const MPU6500_Channels out = { { x, y, z }, NULL, { NULL, NULL, NULL } };
+    MPU6500_FIFO_Batch batch;
+
+    setup();
+    CHECK(MPU6500_SetFullScale(&hmpu, MPU6500_ACCEL_FS_2G, MPU6500_GYRO_FS_250DPS) == HAL_OK);
+    CHECK(MPU6500_FIFO_Enable(&hmpu, MPU6500_FIFO_ACCEL) == HAL_OK);
+    push_frames(16384, 3);                          // 1 g at ±2g
+    CHECK(MPU6500_FIFO_Read(&hmpu, buffer, 8, &batch) == HAL_OK);
+    CHECK(batch.frames == 3 && !batch.resync);
+    CHECK(MPU6500_FIFO_DecodeFloat(&hmpu, buffer, batch.frames, &out) == HAL_OK);
+    CHECK(x[0] == 1.0f);
+
+    push_frames(16384, 3);
+    CHECK(MPU6500_SetFullScale(&hmpu, MPU6500_ACCEL_FS_8G, MPU6500_GYRO_FS_250DPS) == HAL_OK);
+    push_frames(4096, 2);                           // 1 g at ±8g
+    CHECK(MPU6500_FIFO_Read(&hmpu, buffer, 8, &batch) == HAL_OK);
+    CHECK(batch.frames == 0 && batch.resync);
+    CHECK(sim_fifo_count() == 0);
+
+    push_frames(4096, 2);
+    CHECK(MPU6500_FIFO_Read(&hmpu, buffer, 8, &batch) == HAL_OK);
+    CHECK(batch.frames == 2 && !batch.resync);
+    CHECK(MPU6500_FIFO_DecodeFloat(&hmpu, buffer, batch.frames, &out) == HAL_OK);
+    CHECK(x[0] == 1.0f && x[1] == 1.0f);
+
+    // Rewriting the same range keeps the queued frames
+    push_frames(4096, 2);
+    CHECK(MPU6500_SetFullScale(&hmpu, MPU6500_ACCEL_FS_8G, MPU6500_GYRO_FS_250DPS) == HAL_OK);
+    CHECK(MPU6500_FIFO_Read(&hmpu, buffer, 8, &batch) == HAL_OK);
+    CHECK(batch.frames == 2 && !batch.resync);
+}
+
+/* The sample after a switch is converted and tagged with the old range */
+static void test_settling(void){
+    static const int16_t loud[3] = { 32000, 0, 0 };
+    static const int16_t still[3] = { 0, 0, 0 };
+    MPU6500_FixedSample fixed;
+    MPU6500_Sample sample;
+
+    setup();
+    CHECK(MPU6500_SetFullScale(&hmpu, MPU6500_ACCEL_FS_2G, MPU6500_GYRO_FS_250DPS) == HAL_OK);
+    hmpu.accel_offset[0] = 100;
+    MPU6500_SetAutoRange(&hmpu, MPU6500_AUTORANGE_ACCEL);
+    sim_set_sample(loud, 0, still);
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);      // Settling after the explicit switch
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);      // Saturated, steps up to 4g
+    CHECK(!sample.settling && hmpu.accel_fs == MPU6500_ACCEL_FS_4G);
+    CHECK(hmpu.accel_offset[0] == 50);
+
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(sample.settling && sample.accel_fs == MPU6500_ACCEL_FS_2G);
+    CHECK(sample.accel[0] == (float)(32000 - 100) / 16384.0f);
+    CHECK(MPU6500_ReadAll(&hmpu, &sample) == HAL_OK);
+    CHECK(!sample.settling && sample.accel_fs == MPU6500_ACCEL_FS_4G);
+    CHECK(sample.accel[0] == (float)(32000 - 50) / 8192.0f);
+
+    // Still saturated, stepped up to 8g: fixed-point reads follow the same rule
+    CHECK(hmpu.accel_fs == MPU6500_ACCEL_FS_8G);
+    CHECK(MPU6500_ReadAllFixed(&hmpu, MPU6500_FIXED_MILLI, &fixed) == HAL_OK);
+    CHECK(fixed.settling && fixed.accel_fs == MPU6500_ACCEL_FS_4G);
+    CHECK(fixed.accel[0] == 3900);                          // 31950 / 8.192 mg, rounded
+}
+
+/* The completion IRQ leaves auto-ranging to MPU6500_GetAsyncSample */
+static void test_async_tracking(void){
+    static const int16_t loud[3] = { 32000, 0, 0 };
+    static const int16_t still[3] = { 0, 0, 0 };
+    MPU6500_Sample sample;
+
+    setup();
+    MPU6500_SetAutoRange(&hmpu, MPU6500_AUTORANGE_ACCEL);
+    sim_set_sample(loud, 0, still);
+    CHECK(MPU6500_StartReadAll_DMA(&hmpu) == HAL_OK);
+    sim_advance_us(400);
+    CHECK(MPU6500_GetAsyncState(&hmpu) == MPU6500_ASYNC_READY);
+    CHECK(hmpu.autorange.accel_target == MPU6500_ACCEL_FS_4G);  // Untouched by the IRQ
+    CHECK(MPU6500_GetAsyncSample(&hmpu, &sample) == HAL_OK);
+    CHECK(sample.accel_fs == MPU6500_ACCEL_FS_4G && sample.accel[0] == 32000.0f / 8192.0f);
+    CHECK(hmpu.accel_fs == MPU6500_ACCEL_FS_8G);
+}
+
+int main(void){
+    test_fifo_switch();
+    test_settling();
+    test_async_tracking();
+    return sim_failures != 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file test_timestamp.c
+ * @brief MPU6500_FIFO_Timestamp, MPU6500_GetSamplePeriod and
+ *        MPU6500_GetClockDrift against the true sample times of a simulated
+ *        sensor clock off by up to ±1%, with jittered drain times
+ */
+
+#include "mpu6500.h"
+#include "sim.h"
+
+static MPU6500_Transport bus;
+static MPU6500_Handle hmpu;
+
+static uint32_t seed;
+
+/* Drain interval of 4-8 ms, changing every call */
+static uint32_t jitter_us(void){
+    seed = seed * 1664525U + 1013904223U;
+    return 4000U + (seed >> 8) % 4000U;
+}
+
+static uint64_t clock_us(void){
+    return sim_time_us();
+}
+
+/**
+ * @brief Stream for a while and check every timestamp against the true sample time
+ * @param sample_ns Sample period of the sensor clock
+ * @param drift_ppm Expected drift
+ */
+static void run(uint32_t sample_ns, int32_t drift_ppm){
+    uint8_t buffer[64 * 12];
+    uint64_t timestamps[64], last = 0, start_us;
+    MPU6500_FIFO_Batch batch;
+    uint32_t taken = 0, worst = 0;
+    int32_t drift;
+    float period;
+
+    sim_reset();
+    MPU6500_Transport_InitI2C(&bus, &hi2c1);
+    CHECK(MPU6500_Init(&hmpu, &bus, MPU6500_ADDR) == HAL_OK);
+    MPU6500_SetClock(&hmpu, clock_us);
+    CHECK(MPU6500_FIFO_Enable(&hmpu, MPU6500_FIFO_ACCEL | MPU6500_FIFO_GYRO) == HAL_OK);
+    CHECK(MPU6500_GetClockDrift(&hmpu) == 0);
+    seed = sample_ns;
+    sim.sample_ns = sample_ns;
+    start_us = sim_time_us();           // Sample k is taken k sample periods later
+
+    // 20 s of 1 kHz data: about ten drift windows
+    while(sim_time_us() < 20000000U){
+        sim_advance_us(jitter_us());
+        CHECK(MPU6500_FIFO_Read(&hmpu, buffer, 64, &batch) == HAL_OK);
+        CHECK(!batch.resync);
+        CHECK(MPU6500_FIFO_Timestamp(&hmpu, &batch, timestamps) == HAL_OK);
+        for(uint16_t i = 0; i < batch.frames; i++){
+            uint64_t truth = start_us + (uint64_t)(++taken) * sample_ns / 1000U;
+            uint32_t error;
+
+            CHECK(timestamps[i] > last);        // Strictly monotonic across batches
+            last = timestamps[i];
+            error = (uint32_t)((timestamps[i] > truth) ? timestamps[i] - truth : truth - timestamps[i]);
+            if(sim_time_us() > 10000000U && error > worst) worst = error;    // Once the period settled
+        }
+    }
+
+    drift = MPU6500_GetClockDrift(&hmpu);
+    period = MPU6500_GetSamplePeriod(&hmpu);
+    printf("sample period %u ns: drift %ld ppm, period %.1f ns, error %lu us\n",
+           (unsigned)sample_ns, (long)drift, period * 1e9f, (unsigned long)worst);
+    CHECK(drift > drift_ppm - 200 && drift < drift_ppm + 200);
+    CHECK(period > sample_ns * 0.9995e-9f && period < sample_ns * 1.0005e-9f);
+    CHECK(worst < 500);
+}
+
+int main(void){
+    run(1010000, 10000);        // Sensor 1% slow
+    run(990000, -10000);        // Sensor 1% fast
+    run(1000000, 0);
+    return sim_failures != 0;
+}